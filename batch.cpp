@@ -0,0 +1,234 @@
+// Headless batch runner: loads a map and a list of queries (see mapLoader.h
+// for the formats), runs every query through the pathfinder and reports
+// throughput. No window, no SFML.
+//
+// Usage: batch [-jps] [-jpsplus] [-corners] [-smooth] [-buckets] [-heuristic H] [-bidirectional] [-hpa] [-tree] [-reject] [-cache] [-parallel] [-arena] [-save FILE] [-repeat N] <map> <queries>
+//
+// -buckets uses the bucket queue instead of the binary heap as the open list.
+// -heuristic picks the distance estimate of A* and JPS: octile (the
+// default), euclidean, chebyshev, or manhattan (the original scoring).
+// -bidirectional searches from both ends at once.
+// -jpsplus runs JPS on a precomputed jump table; building the table is timed
+// separately from the queries.
+// -hpa runs HPA* on a cluster hierarchy, also timed separately.
+// -tree answers queries from a shortest path tree of their start, regrown
+// whenever the start changes; the tree for the first query's start is
+// built up front, and timed separately.
+// -reject turns down queries between tiles that aren't connected, by
+// component labels, built by the first query (and timed with it).
+// -cache turns on the path cache (only used without -parallel), and
+// reports its hit rate and size.
+// -parallel runs each round of queries as one batch on the thread pool
+// (cPathFinder::findPaths), rather than one after the other.
+// -arena keeps each round's paths in a cPathArena instead (one after the
+// other, without the cache), and reports how much memory they take there,
+// against what they'd take as tile vectors. Path nodes are then counted
+// by walking the stored paths tile by tile.
+// -save writes a snapshot of the board (see snapshot.h) once the tables
+// asked for are built, components included with -reject; a map whose
+// name ends in ".snap" is opened as one. Loading the map is timed.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "mapLoader.h"
+#include "pathfinder.h"
+
+namespace {
+
+void usage()
+{
+    std::cerr << "Usage: batch [-jps] [-jpsplus] [-corners] [-smooth] [-buckets] [-heuristic H] [-bidirectional] [-hpa] [-tree] [-reject] [-cache] [-parallel] [-arena] [-save FILE] [-repeat N] <map> <queries>\n";
+}
+
+bool parseHeuristic(const std::string& name, cHeuristic& h)
+{
+    if ( name == "octile" ) h = cHeuristic::octile;
+    else if ( name == "euclidean" ) h = cHeuristic::euclidean;
+    else if ( name == "chebyshev" ) h = cHeuristic::chebyshev;
+    else if ( name == "manhattan" ) h = cHeuristic::manhattan;
+    else return false;
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    bool            jps { false };
+    bool            jpsPlus { false };
+    bool            corners { false };
+    bool            smooth { false };
+    bool            buckets { false };
+    cHeuristic      heuristic { cHeuristic::octile };
+    bool            bidirectional { false };
+    bool            hpa { false };
+    bool            tree { false };
+    bool            reject { false };
+    bool            cache { false };
+    bool            parallel { false };
+    bool            arena { false };
+    int             repeat { 1 };
+    std::string     saveFile;
+    std::string     mapFile;
+    std::string     queryFile;
+
+    for ( auto i = 1; i < argc; ++i )
+    {
+        std::string arg { argv[i] };
+        if ( arg == "-jps" ) jps = true;
+        else if ( arg == "-jpsplus" ) jps = jpsPlus = true;
+        else if ( arg == "-corners" ) corners = true;
+        else if ( arg == "-smooth" ) smooth = true;
+        else if ( arg == "-buckets" ) buckets = true;
+        else if ( arg == "-heuristic" && i + 1 < argc )
+        {
+            if ( !parseHeuristic(argv[++i], heuristic) ) { usage(); return 1; }
+        }
+        else if ( arg == "-bidirectional" ) bidirectional = true;
+        else if ( arg == "-hpa" ) hpa = true;
+        else if ( arg == "-tree" ) tree = true;
+        else if ( arg == "-reject" ) reject = true;
+        else if ( arg == "-cache" ) cache = true;
+        else if ( arg == "-arena" ) arena = true;
+        else if ( arg == "-parallel" ) parallel = true;
+        else if ( arg == "-save" && i + 1 < argc ) saveFile = argv[++i];
+        else if ( arg == "-repeat" && i + 1 < argc ) repeat = std::atoi(argv[++i]);
+        else if ( mapFile.empty() ) mapFile = arg;
+        else if ( queryFile.empty() ) queryFile = arg;
+        else { usage(); return 1; }
+    }
+
+    if ( mapFile.empty() || queryFile.empty() || repeat < 1 ) { usage(); return 1; }
+
+    std::unique_ptr<cPathFinder>    p;
+    std::vector<cQuery>             queries;
+    double                          loadSeconds { 0 };
+
+    try
+    {
+        auto begin = std::chrono::steady_clock::now();
+        auto snapshot = mapFile.size() > 5 && mapFile.compare(mapFile.size() - 5, 5, ".snap") == 0;
+        if ( snapshot ) p = openSnapshot(mapFile);
+        else
+        {
+            std::ifstream   mapIn { mapFile };
+            if ( !mapIn ) throw std::runtime_error("Cannot open " + mapFile);
+            p = loadMap(mapIn);
+        }
+        loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::ifstream   queryIn { queryFile };
+        if ( !queryIn ) throw std::runtime_error("Cannot open " + queryFile);
+        queries = loadQueries(queryIn);
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    p->mJPS = jps;
+    p->mOpenList = buckets ? cOpenList::buckets : cOpenList::binaryHeap;
+    p->mHeuristic = heuristic;
+    p->mBidirectional = bidirectional;
+    p->mJPSPlus = jpsPlus;
+    p->mHPA = hpa;
+    p->mPathTree = tree;
+    p->mRejectUnreachable = reject;
+    p->mCachePaths = cache;
+    
+    double tableSeconds { 0 };
+    if ( tree && !queries.empty() )
+    {
+        auto begin = std::chrono::steady_clock::now();
+        p->buildPathTree(queries.front().start, corners);
+        tableSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    else if ( jpsPlus || hpa )
+    {
+        auto begin = std::chrono::steady_clock::now();
+        if ( hpa ) p->buildHierarchy(corners);
+        else p->buildJumpTable(corners);
+        tableSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    if ( !saveFile.empty() )
+    {
+        try
+        {
+            if ( reject ) p->buildComponents(corners);
+            p->saveSnapshot(saveFile);
+        }
+        catch ( const std::exception& e )
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    unsigned long   found { 0 };
+    unsigned long   pathNodes { 0 };
+    cWorkspace      ws { p->width() * p->height() };
+    cPathArena      paths;
+
+    auto begin = std::chrono::steady_clock::now();
+    for ( auto r = 0; r < repeat; ++r )
+        if ( arena )
+        {
+            paths.clear();
+            for ( auto& q : queries )
+            {
+                auto id = p->findPath(ws, paths, q.start, q.goal, corners, smooth);
+                if ( id == cPathArena::npos ) continue;
+                ++found;
+                for ( auto& c : paths.cells(id) ) { (void)c; ++pathNodes; }
+            }
+        }
+        else if ( parallel )
+        {
+            for ( auto& path : p->findPaths(queries, corners, smooth) )
+            {
+                if ( !path.empty() ) ++found;
+                pathNodes += path.size();
+            }
+        }
+        else for ( auto& q : queries )
+        {
+            auto path = p->findPath(q.start, q.goal, corners, smooth);
+            if ( !path.empty() ) ++found;
+            pathNodes += path.size();
+        }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    unsigned long total = queries.size() * repeat;
+
+    std::cout << "map:            " << mapFile << " (" << p->width() << "x" << p->height() << ")\n"
+              << "map load (s):   " << loadSeconds << "\n"
+              << "queries:        " << total << "\n"
+              << "paths found:    " << found << "\n"
+              << "path nodes:     " << pathNodes << "\n"
+              << "total time (s): " << seconds << "\n";
+    if ( tree )
+        std::cout << "tree build (s):  " << tableSeconds << "\n";
+    else if ( hpa )
+        std::cout << "hierarchy build (s): " << tableSeconds << "\n";
+    else if ( jpsPlus )
+        std::cout << "table build (s): " << tableSeconds << "\n";
+    if ( cache )
+        std::cout << "cache hit rate: " << p->pathCache().hitRate() << "\n"
+                  << "cache entries:  " << p->pathCache().size() << "\n"
+                  << "cache bytes:    " << p->pathCache().memoryUsage() << "\n";
+    if ( arena )
+        std::cout << "arena paths:    " << paths.size() << "\n"
+                  << "arena bytes:    " << paths.memoryUsage() << "\n"
+                  << "as tiles:       " << pathNodes / repeat * sizeof(cNodeID) << "\n";
+    if ( total > 0 && seconds > 0 )
+        std::cout << "queries / s:    " << total / seconds << "\n"
+                  << "avg. (microsec): " << seconds * 1e6 / total << "\n";
+
+    return 0;
+}
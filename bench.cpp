@@ -0,0 +1,445 @@
+// Benchmark runner for the Moving AI pathfinding benchmarks: loads a .map
+// and its .scen (see mapLoader.h), runs every scenario through each
+// configuration, and reports per configuration
+//
+//  - query time percentiles, in microseconds;
+//  - the search statistics of searchStats.h, averaged per query: node
+//    expansions, open list pushes and decreases, jumps, line checks, and
+//    the time spent searching, reconstructing and smoothing. Zeros when
+//    built with PATHFINDER_STATS=0;
+//  - the mean length of the paths found, measured straight between their
+//    nodes, so that any-angle paths (Theta*) get credit for their shortcuts;
+//  - how path costs compare to the scenario's optimal length: equal
+//    (within 0.001), longer, or shorter. Only for runs without corner
+//    cutting, which is what the optimal lengths assume. A path can come
+//    out shorter, because JPS without corner cutting still squeezes past
+//    a single corner. Then the mean and the worst cost ratio, and the mean
+//    bound the searches proved (see below);
+//  - heap allocations per query, counted by a replacement operator new.
+//    Each configuration first runs every scenario once, untimed, so that
+//    the workspace and the path have grown to fit them: what's measured
+//    is the steady state, in which A*, JPS and Theta* allocate nothing.
+//
+// as CSV (the default) or JSON. No window, no SFML.
+//
+// Usage: bench [-json] [-engines astar,jps,jpsplus,hpa,theta,lazytheta,...] [-heuristics octile,...] [-weight W] [-budget N] [-deadline US] [-repeat N] [-paged BYTES] <map> <scen>
+//
+// Each engine runs with and without corner cutting and smoothing, and A*,
+// JPS and Theta* with each heuristic (octile, euclidean, chebyshev, manhattan; see
+// scoring.h). The defaults are astar and jps, with octile distance;
+// astar-bi, jps-bi and jpsplus-bi are the bidirectional versions (the
+// last two run A* without corner cutting; see mBidirectional). HPA*
+// has a heuristic of its own, and runs once. With -repeat, every scenario
+// runs N times, and each run counts as a sample for the percentiles.
+//
+// The suffixes -w, -focal and -ara (astar-w, jps-focal, ...) run A*, JPS
+// and JPS+ as weighted A*, focal search and ARA* (see cSuboptimal), with
+// the weight of -weight (1.5 by default); ARA* gets a budget of -budget
+// expansions and -deadline microseconds per query, if given. Every run
+// also reports the mean of the bounds the searches proved for their
+// paths (see cWorkspace::bound()), and the worst cost ratio.
+//
+// With -paged, the map is opened as a paged board (see openMovingAIMap())
+// with a budget of BYTES, trimmed back to it after every query, untimed;
+// the chunks loaded during a query count towards its time and its
+// allocations. What the board held at the end goes to stderr.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "mapLoader.h"
+#include "pathfinder.h"
+
+namespace {
+
+std::atomic<unsigned long long> allocations { 0 };
+
+}
+
+// Every other form of new and delete ends up in these two; the array and
+// sized deletes (C++14) are spelled out, so that they match.
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if ( auto p = std::malloc(size ? size : 1) ) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    ::operator delete(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    ::operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    ::operator delete[](p);
+}
+
+namespace {
+
+struct cResult {
+    std::string             engine;
+    std::string             heuristic;
+    bool                    cornerCutting;
+    bool                    smooth;
+    unsigned long           queries { 0 };
+    unsigned long           found { 0 };
+    double                  length { 0 };
+    std::vector<double>     micros;
+    unsigned long long      expanded { 0 };
+    double                  pushes { 0 };
+    double                  decreases { 0 };
+    double                  jumps { 0 };
+    double                  lineChecks { 0 };
+    double                  searchMicros { 0 };
+    double                  reconstructMicros { 0 };
+    double                  smoothMicros { 0 };
+    unsigned long long      allocations { 0 };
+    unsigned long           compared { 0 };
+    unsigned long           optimal { 0 };
+    unsigned long           longer { 0 };
+    unsigned long           shorter { 0 };
+    double                  ratioSum { 0 };
+    double                  ratioMax { 0 };
+    double                  boundSum { 0 };
+};
+
+void usage()
+{
+    std::cerr << "Usage: bench [-json] [-engines astar,jps,jpsplus,hpa,theta,lazytheta,...] [-heuristics octile,...] [-weight W] [-budget N] [-deadline US] [-repeat N] [-paged BYTES] <map> <scen>\n";
+}
+
+// Octile length, sqrt(2) for a diagonal step, as in the .scen files:
+// the length of the tile by tile walk between consecutive nodes.
+double cost(const nodevec& path)
+{
+    double c { 0 };
+    for ( size_t i = 1; i < path.size(); ++i )
+    {
+        double dx = std::abs(path[i].x - path[i - 1].x);
+        double dy = std::abs(path[i].y - path[i - 1].y);
+        c += std::max(dx, dy) + (std::sqrt(2.0) - 1) * std::min(dx, dy);
+    }
+    return c;
+}
+
+// Straight line length, from node to node.
+double length(const nodevec& path)
+{
+    double l { 0 };
+    for ( size_t i = 1; i < path.size(); ++i )
+        l += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+    return l;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if ( sorted.empty() ) return 0;
+    auto i = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(i, 1)) - 1];
+}
+
+bool parseHeuristic(const std::string& name, cHeuristic& h)
+{
+    if ( name == "octile" ) h = cHeuristic::octile;
+    else if ( name == "euclidean" ) h = cHeuristic::euclidean;
+    else if ( name == "chebyshev" ) h = cHeuristic::chebyshev;
+    else if ( name == "manhattan" ) h = cHeuristic::manhattan;
+    else return false;
+    return true;
+}
+
+// The suffixes an engine's name may have, and what they turn on.
+const char* suffixes[] { "-bi", "-w", "-focal", "-ara" };
+
+void configure(cPathFinder& p, const std::string& engine, bool cc)
+{
+    auto dash = engine.find('-');
+    auto base = engine.substr(0, dash);
+    auto suffix = dash == std::string::npos ? std::string { } : engine.substr(dash);
+
+    p.mJPS = base == "jps" || base == "jpsplus";
+    p.mJPSPlus = base == "jpsplus";
+    p.mHPA = base == "hpa";
+    p.mThetaStar = base == "theta" || base == "lazytheta";
+    p.mLazyTheta = base == "lazytheta";
+    p.mBidirectional = suffix == "-bi";
+    p.mSuboptimal = suffix == "-w" ? cSuboptimal::weighted :
+                    suffix == "-focal" ? cSuboptimal::focal :
+                    suffix == "-ara" ? cSuboptimal::anytime : cSuboptimal::off;
+
+    if ( p.mHPA ) p.buildHierarchy(cc);
+    if ( p.mJPSPlus ) p.buildJumpTable(cc);
+}
+
+void report(const std::vector<cResult>& results, const std::string& mapFile, bool json)
+{
+    const char* fields[] { "engine", "heuristic", "corner_cutting", "smoothing", "queries", "found",
+                           "time_mean_us", "time_p50_us", "time_p90_us", "time_p99_us", "time_max_us",
+                           "expanded_mean", "expanded_total", "pushes_mean", "decreases_mean",
+                           "jumps_mean", "line_checks_mean", "search_us_mean", "reconstruct_us_mean",
+                           "smooth_us_mean", "length_mean",
+                           "compared", "optimal", "longer", "shorter", "cost_ratio_mean",
+                           "cost_ratio_max", "bound_mean", "allocations_mean" };
+
+    if ( json ) std::cout << "{\n  \"map\": \"" << mapFile << "\",\n  \"results\": [\n";
+    else
+    {
+        for ( auto& f : fields ) std::cout << (&f == fields ? "" : ",") << f;
+        std::cout << "\n";
+    }
+
+    for ( size_t r = 0; r < results.size(); ++r )
+    {
+        auto res = results[r];
+        std::sort(res.micros.begin(), res.micros.end());
+
+        double mean { 0 };
+        for ( auto t : res.micros ) mean += t;
+        if ( !res.micros.empty() ) mean /= res.micros.size();
+
+        const int           count = sizeof(fields) / sizeof(fields[0]);
+        std::ostringstream  values[count];
+        auto                perQuery = [&res](double total) { return res.queries ? total / res.queries : 0; };
+        
+        values[0] << (json ? "\"" + res.engine + "\"" : res.engine);
+        values[1] << (json ? "\"" + res.heuristic + "\"" : res.heuristic);
+        values[2] << (res.cornerCutting ? "true" : "false");
+        values[3] << (res.smooth ? "true" : "false");
+        values[4] << res.queries;
+        values[5] << res.found;
+        values[6] << mean;
+        values[7] << percentile(res.micros, 50);
+        values[8] << percentile(res.micros, 90);
+        values[9] << percentile(res.micros, 99);
+        values[10] << (res.micros.empty() ? 0 : res.micros.back());
+        values[11] << perQuery(res.expanded);
+        values[12] << res.expanded;
+        values[13] << perQuery(res.pushes);
+        values[14] << perQuery(res.decreases);
+        values[15] << perQuery(res.jumps);
+        values[16] << perQuery(res.lineChecks);
+        values[17] << perQuery(res.searchMicros);
+        values[18] << perQuery(res.reconstructMicros);
+        values[19] << perQuery(res.smoothMicros);
+        values[20] << (res.found ? res.length / res.found : 0);
+        values[21] << res.compared;
+        values[22] << res.optimal;
+        values[23] << res.longer;
+        values[24] << res.shorter;
+        values[25] << (res.compared ? res.ratioSum / res.compared : 0);
+        values[26] << res.ratioMax;
+        values[27] << (res.found ? res.boundSum / res.found : 0);
+        values[28] << perQuery(res.allocations);
+
+        if ( json )
+        {
+            std::cout << "    {";
+            for ( auto i = 0; i < count; ++i )
+                std::cout << (i ? ", " : " ") << "\"" << fields[i] << "\": " << values[i].str();
+            std::cout << " }" << (r + 1 < results.size() ? "," : "") << "\n";
+        }
+        else
+        {
+            for ( auto i = 0; i < count; ++i )
+                std::cout << (i ? "," : "") << values[i].str();
+            std::cout << "\n";
+        }
+    }
+
+    if ( json ) std::cout << "  ]\n}\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    bool                        json { false };
+    int                         repeat { 1 };
+    long int                    paged { -1 };
+    double                      weight { 1.5 };
+    unsigned long               budget { 0 };
+    double                      deadline { 0 };
+    std::vector<std::string>    engines { "astar", "jps" };
+    std::vector<std::string>    heuristics { "octile" };
+    std::string                 mapFile;
+    std::string                 scenFile;
+
+    for ( auto i = 1; i < argc; ++i )
+    {
+        std::string arg { argv[i] };
+        if ( arg == "-json" ) json = true;
+        else if ( arg == "-repeat" && i + 1 < argc ) repeat = std::atoi(argv[++i]);
+        else if ( arg == "-paged" && i + 1 < argc ) paged = std::atol(argv[++i]);
+        else if ( arg == "-weight" && i + 1 < argc ) weight = std::atof(argv[++i]);
+        else if ( arg == "-budget" && i + 1 < argc ) budget = std::strtoul(argv[++i], nullptr, 10);
+        else if ( arg == "-deadline" && i + 1 < argc ) deadline = std::atof(argv[++i]);
+        else if ( arg == "-engines" && i + 1 < argc )
+        {
+            engines.clear();
+            std::istringstream  list { argv[++i] };
+            std::string         e;
+            while ( std::getline(list, e, ',') )
+            {
+                auto base = e.substr(0, e.find('-'));
+                bool search = base == "astar" || base == "jps" || base == "jpsplus";
+                bool plain = e == base && (search || e == "hpa" || e == "theta" || e == "lazytheta");
+                bool suffixed = search && std::any_of(std::begin(suffixes), std::end(suffixes),
+                                                      [&](const char* s) { return e == base + s; });
+                if ( !plain && !suffixed ) { usage(); return 1; }
+                engines.push_back(e);
+            }
+        }
+        else if ( arg == "-heuristics" && i + 1 < argc )
+        {
+            heuristics.clear();
+            std::istringstream  list { argv[++i] };
+            std::string         h;
+            cHeuristic          unused;
+            while ( std::getline(list, h, ',') )
+            {
+                if ( !parseHeuristic(h, unused) ) { usage(); return 1; }
+                heuristics.push_back(h);
+            }
+        }
+        else if ( mapFile.empty() ) mapFile = arg;
+        else if ( scenFile.empty() ) scenFile = arg;
+        else { usage(); return 1; }
+    }
+
+    if ( mapFile.empty() || scenFile.empty() || repeat < 1 || engines.empty() || heuristics.empty() ||
+         !(weight >= 1) ) { usage(); return 1; }
+
+    std::unique_ptr<cPathFinder>    p;
+    std::vector<cScenario>          scenarios;
+
+    try
+    {
+        if ( paged >= 0 ) p = openMovingAIMap(mapFile, paged);
+        else
+        {
+            std::ifstream   mapIn { mapFile };
+            if ( !mapIn ) throw std::runtime_error("Cannot open " + mapFile);
+            p = loadMovingAIMap(mapIn);
+        }
+
+        std::ifstream   scenIn { scenFile };
+        if ( !scenIn ) throw std::runtime_error("Cannot open " + scenFile);
+        scenarios = loadScenarios(scenIn);
+
+        for ( auto& s : scenarios )
+            if ( !p->valid(s.start.x, s.start.y) || !p->valid(s.goal.x, s.goal.y) )
+                throw std::runtime_error("Scenario off the map: " + s.map);
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    cWorkspace              ws { p->width() * p->height() };
+    nodevec                 path;
+    std::vector<cResult>    results;
+
+    p->mWeight = weight;
+    p->mExpansionBudget = budget;
+    p->mDeadlineMicros = deadline;
+
+    for ( auto& engine : engines )
+        for ( auto& heuristic : heuristics )
+        {
+            // HPA* has a heuristic of its own.
+            if ( engine == "hpa" && &heuristic != &heuristics.front() ) break;
+            parseHeuristic(heuristic, p->mHeuristic);
+
+            for ( auto cc : { false, true } )
+            {
+                configure(*p, engine, cc);
+
+                for ( auto smooth : { false, true } )
+                {
+                    cResult res;
+                    res.engine = engine;
+                    res.heuristic = engine == "hpa" ? "octile" : heuristic;
+                    res.cornerCutting = cc;
+                    res.smooth = smooth;
+
+                    for ( auto& s : scenarios )
+                    {
+                        p->findPath(ws, s.start, s.goal, path, cc, smooth);
+                        p->trim();
+                    }
+                    res.micros.reserve(repeat * scenarios.size());
+
+                    for ( auto r = 0; r < repeat; ++r )
+                        for ( auto& s : scenarios )
+                        {
+                            auto allocated = allocations.load();
+                            auto begin = std::chrono::steady_clock::now();
+                            p->findPath(ws, s.start, s.goal, path, cc, smooth);
+                            auto end = std::chrono::steady_clock::now();
+                            res.allocations += allocations - allocated;
+                            p->trim();
+
+                            res.micros.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+                            auto& stats = ws.stats();
+                            res.expanded += stats.expanded;
+                            res.pushes += stats.pushes;
+                            res.decreases += stats.decreases;
+                            res.jumps += stats.jumps;
+                            res.lineChecks += stats.lineChecks;
+                            res.searchMicros += stats.searchMicros;
+                            res.reconstructMicros += stats.reconstructMicros;
+                            res.smoothMicros += stats.smoothMicros;
+                            ++res.queries;
+
+                            if ( path.empty() ) continue;
+                            ++res.found;
+                            res.length += length(path);
+                            res.boundSum += ws.bound();
+
+                            if ( cc || s.optimal <= 0 ) continue;
+                            auto c = cost(path);
+                            ++res.compared;
+                            res.ratioSum += c / s.optimal;
+                            res.ratioMax = std::max(res.ratioMax, c / s.optimal);
+                            if ( std::abs(c - s.optimal) <= 1e-3 ) ++res.optimal;
+                            else if ( c > s.optimal ) ++res.longer;
+                            else ++res.shorter;
+                        }
+
+                    results.push_back(res);
+                }
+            }
+        }
+
+    report(results, mapFile, json);
+
+    if ( paged >= 0 )
+    {
+        auto& b = p->board();
+        std::cerr << "board: " << b.chunks() << " chunks, " << b.storedChunks() << " stored, " <<
+                     b.uniformChunks() << " uniform, " << b.chunkLoads() << " loads, " <<
+                     b.memoryUsage() << " bytes\n";
+    }
+    return 0;
+}
@@ -1 +1,430 @@
 #include "board.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Bits "from" to "to" (inclusive) of a row or column, as far as they fall
+// in word k.
+uint64_t span(long int k, long int from, long int to)
+{
+    auto mask = ~uint64_t(0);
+    if ( k == from >> 6 ) mask &= ~uint64_t(0) << (from & 63);
+    if ( k == to >> 6 ) mask &= ~uint64_t(0) >> (63 - (to & 63));
+    return mask;
+}
+
+// Whether bits "from" to "to" (inclusive) of a row or column are all set.
+bool allSet(const uint64_t* words, long int from, long int to)
+{
+    for ( auto k = from >> 6; k <= to >> 6; ++k )
+    {
+        auto mask = span(k, from, to);
+        if ( (words[k] & mask) != mask ) return false;
+    }
+    return true;
+}
+
+// The lowest n bits, n <= 64.
+uint64_t low(long int n)
+{
+    return n >= 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+}
+
+}
+
+const unsigned int cBoard::chunkSize;
+
+cBoard::cBoard(unsigned int width, unsigned int height):
+cBoard(width, height, cChunkLoader { }, 0)
+{
+}
+
+cBoard::cBoard(unsigned int width, unsigned int height, cChunkLoader loader, size_t budget):
+mWidth { width },
+mHeight { height },
+mWordsPerRow { (width + 63) / 64 },
+mWordsPerColumn { (height + 63) / 64 },
+mPaged { bool(loader) },
+mLoader { std::move(loader) },
+mBudget { budget }
+{
+    // Tiles are numbered (see index()) with 32 bits, and ~0u means "none"
+    // to the tables that store them.
+    if ( size() >= ~0u ) throw std::runtime_error("Board too big: more than 2^32 - 1 tiles.");
+
+    if ( mPaged )
+    {
+        mChunks.reset(new std::atomic<const cChunk*>[chunks()]);
+        for ( size_t i = 0; i < chunks(); ++i ) mChunks[i].store(nullptr, std::memory_order_relaxed);
+        mStored.resize(chunks());
+        mEdited.assign(chunks(), 0);
+        return;
+    }
+
+    // Everything is walkable to begin with, except for the padding
+    // at the end of each row (and column).
+    mWalkable.assign(static_cast<size_t>(mWordsPerRow) * height, 0);
+    mWalkableT.assign(static_cast<size_t>(mWordsPerColumn) * width, 0);
+    for ( size_t y = 0; y < mHeight; ++y )
+        for ( size_t k = 0; k < mWordsPerRow; ++k )
+            mWalkable[y * mWordsPerRow + k] = low(static_cast<long int>(mWidth) - 64 * static_cast<long int>(k));
+    for ( size_t x = 0; x < mWidth; ++x )
+        for ( size_t k = 0; k < mWordsPerColumn; ++k )
+            mWalkableT[x * mWordsPerColumn + k] = low(static_cast<long int>(mHeight) - 64 * static_cast<long int>(k));
+    mRows = mWalkable.data();
+    mColumns = mWalkableT.data();
+}
+
+cBoard::cBoard(unsigned int width, unsigned int height, const uint64_t* rows, const uint64_t* columns):
+mWidth { width },
+mHeight { height },
+mWordsPerRow { (width + 63) / 64 },
+mWordsPerColumn { (height + 63) / 64 },
+mPaged { false },
+mRows { rows },
+mColumns { columns }
+{
+    if ( size() >= ~0u ) throw std::runtime_error("Board too big: more than 2^32 - 1 tiles.");
+}
+
+void cBoard::own()
+{
+    if ( !borrowed() ) return;
+
+    mWalkable.assign(mRows, mRows + static_cast<size_t>(mWordsPerRow) * mHeight);
+    mWalkableT.assign(mColumns, mColumns + static_cast<size_t>(mWordsPerColumn) * mWidth);
+    mRows = mWalkable.data();
+    mColumns = mWalkableT.data();
+}
+
+const cBoard::cChunk& cBoard::uniformChunk(bool walkable)
+{
+    static const cChunk chunks[2] = { cChunk { }, []()
+    {
+        cChunk c;
+        std::fill(std::begin(c.rows), std::end(c.rows), ~uint64_t(0));
+        std::fill(std::begin(c.columns), std::end(c.columns), ~uint64_t(0));
+        return c;
+    }() };
+    return chunks[walkable];
+}
+
+const cBoard::cChunk* cBoard::uniform(const cChunk& c)
+{
+    for ( auto walkable : { false, true } )
+    {
+        auto w = walkable ? ~uint64_t(0) : 0;
+        if ( std::all_of(std::begin(c.rows), std::end(c.rows), [w](uint64_t r) { return r == w; }) )
+            return &uniformChunk(walkable);
+    }
+    return nullptr;
+}
+
+uint64_t cBoard::rowMask(size_t i) const
+{
+    return low(static_cast<long int>(mWidth) - 64 * static_cast<long int>(i % mWordsPerRow));
+}
+
+uint64_t cBoard::columnMask(size_t i) const
+{
+    return low(static_cast<long int>(mHeight) - 64 * static_cast<long int>(i / mWordsPerRow));
+}
+
+const cBoard::cChunk* cBoard::settle(size_t i, std::unique_ptr<cChunk> c) const
+{
+    // Chunks along the right and bottom edges stick out of the board; the
+    // shared walkable chunk never stands in for those.
+    auto rowBits = rowMask(i), columnBits = columnMask(i);
+    for ( auto j = 0; j < 64; ++j ) c->rows[j] &= (columnBits >> j) & 1 ? rowBits : 0;
+
+    if ( auto u = uniform(*c) ) return u;
+
+    std::fill(std::begin(c->columns), std::end(c->columns), 0);
+    for ( auto j = 0; j < 64; ++j )
+        for ( auto r = c->rows[j]; r; r &= r - 1 )
+            c->columns[__builtin_ctzll(r)] |= uint64_t(1) << j;
+
+    mStored[i] = std::move(c);
+    ++mStoredCount;
+    return mStored[i].get();
+}
+
+const cBoard::cChunk& cBoard::load(size_t i, long int cx, long int cy) const
+{
+    std::lock_guard<std::mutex> lock { mLock };
+
+    // Another search may have got here first.
+    if ( auto c = mChunks[i].load(std::memory_order_relaxed) ) return *c;
+
+    std::unique_ptr<cChunk> c { new cChunk };
+    std::fill(std::begin(c->rows), std::end(c->rows), 0);
+    mLoader(static_cast<unsigned int>(cx), static_cast<unsigned int>(cy), c->rows);
+    ++mLoads;
+
+    auto settled = settle(i, std::move(c));
+    if ( mStored[i] ) mLoaded.push_back(i);
+    mChunks[i].store(settled, std::memory_order_release);
+    return *settled;
+}
+
+bool cBoard::clearRow(long int y, long int x0, long int x1) const
+{
+    if ( x0 > x1 ) std::swap(x0, x1);
+    if ( y < 0 || y >= mHeight || x0 < 0 || x1 >= mWidth ) return false;
+    if ( !mPaged ) return allSet(&mRows[y * mWordsPerRow], x0, x1);
+
+    for ( auto k = x0 >> 6; k <= x1 >> 6; ++k )
+    {
+        auto mask = span(k, x0, x1);
+        if ( (rowWord(y, k) & mask) != mask ) return false;
+    }
+    return true;
+}
+
+bool cBoard::clearColumn(long int x, long int y0, long int y1) const
+{
+    if ( y0 > y1 ) std::swap(y0, y1);
+    if ( x < 0 || x >= mWidth || y0 < 0 || y1 >= mHeight ) return false;
+    if ( !mPaged ) return allSet(&mColumns[x * mWordsPerColumn], y0, y1);
+
+    for ( auto k = y0 >> 6; k <= y1 >> 6; ++k )
+    {
+        auto mask = span(k, y0, y1);
+        if ( (columnWord(x, k) & mask) != mask ) return false;
+    }
+    return true;
+}
+
+void cBoard::setBlocked(unsigned int x, unsigned int y, bool b)
+{
+    if ( !valid(x, y) ) return;
+
+    uint64_t* word;
+    uint64_t* wordT;
+    if ( mPaged )
+    {
+        if ( blocked(x, y) == b ) return;
+
+        // A shared chunk gets bits of its own first.
+        auto i = static_cast<size_t>(y >> 6) * mWordsPerRow + (x >> 6);
+        if ( !mStored[i] )
+        {
+            mStored[i].reset(new cChunk(chunk(x >> 6, y >> 6)));
+            ++mStoredCount;
+            mChunks[i].store(mStored[i].get(), std::memory_order_release);
+        }
+        mEdited[i] = 1;
+        mEditedSinceCompact = true;
+
+        word = &mStored[i]->rows[y & 63];
+        wordT = &mStored[i]->columns[x & 63];
+    }
+    else
+    {
+        own();
+        word = &mWalkable[y * mWordsPerRow + (x >> 6)];
+        wordT = &mWalkableT[x * mWordsPerColumn + (y >> 6)];
+    }
+
+    auto bit = uint64_t(1) << (x & 63);
+    auto bitT = uint64_t(1) << (y & 63);
+    if ( b )
+    {
+        *word &= ~bit;
+        *wordT &= ~bitT;
+    }
+    else
+    {
+        *word |= bit;
+        *wordT |= bitT;
+    }
+}
+
+void cBoard::trim()
+{
+    if ( !mPaged || mStoredCount * sizeof(cChunk) <= mBudget ) return;
+
+    compact();
+    while ( mStoredCount * sizeof(cChunk) > mBudget && !mLoaded.empty() )
+    {
+        auto i = mLoaded.front();
+        mLoaded.pop_front();
+        if ( !mStored[i] || mEdited[i] ) continue;
+
+        mChunks[i].store(nullptr, std::memory_order_relaxed);
+        mStored[i].reset();
+        --mStoredCount;
+    }
+}
+
+void cBoard::compact()
+{
+    if ( !mEditedSinceCompact ) return;
+    mEditedSinceCompact = false;
+
+    for ( size_t i = 0; i < chunks(); ++i )
+    {
+        if ( !mEdited[i] || !mStored[i] ) continue;
+
+        auto u = uniform(*mStored[i]);
+        if ( !u ) continue;
+
+        // The shared chunk holds the same bits, and is never dropped, so
+        // nothing edited is lost.
+        mChunks[i].store(u, std::memory_order_relaxed);
+        mStored[i].reset();
+        --mStoredCount;
+        mEdited[i] = 0;
+    }
+}
+
+size_t cBoard::storedChunks() const
+{
+    if ( !mPaged ) return chunks();
+
+    std::lock_guard<std::mutex> lock { mLock };
+    return mStoredCount;
+}
+
+size_t cBoard::uniformChunks() const
+{
+    size_t n { 0 };
+    for ( size_t i = 0; mPaged && i < chunks(); ++i )
+    {
+        auto c = mChunks[i].load(std::memory_order_acquire);
+        if ( c == &uniformChunk(false) || c == &uniformChunk(true) ) ++n;
+    }
+    return n;
+}
+
+size_t cBoard::chunkLoads() const
+{
+    std::lock_guard<std::mutex> lock { mLock };
+    return mLoads;
+}
+
+size_t cBoard::memoryUsage() const
+{
+    if ( !mPaged ) return (mWalkable.capacity() + mWalkableT.capacity()) * sizeof(uint64_t);
+
+    std::lock_guard<std::mutex> lock { mLock };
+    return mStoredCount * sizeof(cChunk) +
+           chunks() * (sizeof(std::atomic<const cChunk*>) + sizeof(std::unique_ptr<cChunk>) + sizeof(char)) +
+           mLoaded.size() * sizeof(size_t);
+}
+
+void cBoard::toggle(unsigned int x, unsigned int y)
+{
+    if ( !valid(x, y) ) return;
+    setBlocked(x, y, !blocked(x, y));
+}
+
+// Toggles every tile in the rectangle spanned by the two corners;
+// the corners may be given in any order.
+void cBoard::toggleArea(const cNodeID& a, const cNodeID& b)
+{
+    auto left = std::max(0, std::min(a.x, b.x));
+    auto right = std::min(static_cast<int>(mWidth) - 1, std::max(a.x, b.x));
+    auto top = std::max(0, std::min(a.y, b.y));
+    auto bottom = std::min(static_cast<int>(mHeight) - 1, std::max(a.y, b.y));
+
+    for ( auto i = left; i <= right; ++i )
+        for ( auto j = top; j <= bottom; ++j )
+            toggle(i, j);
+}
+
+// Does the tile have a neighbour that only becomes interesting when we
+// arrive here moving in the direction (dx, dy)? That is, is there a tile
+// next to us that is walkable, but "hidden" behind a blocked one as seen
+// from where we came from? This is the heart of jump point search.
+bool cBoard::has_forced_neighbour(const cNodeID &id,
+                                  int dx,
+                                  int dy) const
+{
+    auto nx = id.x, ny = id.y;
+    
+    if ( dy == 0 )
+    {
+        if ( dx == 1 )  // straight, from left to right
+        {
+            return ((!blocked(nx+1, ny-1) &&    // 2 walkable
+                    blocked(nx, ny-1))          // 1 blocked
+                    ||
+                    (!blocked(nx+1, ny+1) &&    // 8 walkable
+                     blocked(nx, ny+1)));       // 7 blocked
+        }
+        
+        if (dx == -1) // straight, from right to left
+        {
+            return ((!blocked(nx-1, ny-1) &&    // 0 walkable
+                     blocked(nx, ny-1))         // 1 blocked
+                    ||
+                    (!blocked(nx-1, ny+1) &&    // 6 walkable
+                     blocked(nx, ny+1)));       // 7 blocked
+        }
+    }
+    
+    if ( dx == 0 )
+    {
+        if ( dy == 1 )  // straight, from top to bottom
+        {
+            return ((!blocked(nx+1, ny+1) &&    // 8 walkable
+                     blocked(nx+1, ny))         // 5 blocked
+                    ||
+                    (!blocked(nx-1, ny+1) &&    // 6 walkable
+                     blocked(nx-1, ny)));          // 3 blocked
+        }
+        
+        if ( dy == -1) // straight, from bottom to top
+        {
+            return ((!blocked(nx-1, ny-1) &&    // 0 walkable
+                     blocked(nx-1, ny))       // 3 blocked
+                    ||
+                    (!blocked(nx+1, ny-1) &&    // 2 walkable
+                     blocked(nx+1, ny)));       // 5 blocked
+        }
+    }
+    
+    if ( dx > 0 && dy < 0 )
+    {
+        return ((!blocked(nx-1, ny-1) &&       // 0 walkable
+                 blocked(nx-1, ny))            // 3 blocked
+                ||
+                (!blocked(nx+1, ny+1) &&        // 8 walkable
+                 blocked(nx, ny+1)));            // 7 blocked
+    }
+    
+    if ( dx > 0 && dy > 0 )
+    {
+        return ((!blocked(nx+1, ny-1) &&       // 2 walkable
+                 blocked(nx, ny-1))          // 1 blocked
+                ||
+                (!blocked(nx-1, ny+1) &&        // 6 walkable
+                 blocked(nx-1, ny)));          // 3 blocked
+    }
+    
+    if ( dx < 0 && dy > 0 )
+    {
+        return ((!blocked(nx-1, ny-1) &&       // 0 walkable
+                 blocked(nx, ny-1))           // 1 blocked
+                ||
+                (!blocked(nx+1, ny+1) &&        // 8 walkable
+                 blocked(nx+1, ny)));            // 5 blocked
+    }
+    
+    if ( dx < 0 && dy < 0 )
+    {
+        return ((!blocked(nx+1, ny-1) &&       // 2 walkable
+                 blocked(nx+1, ny))           // 5 blocked
+                ||
+                (!blocked(nx-1, ny+1) &&        // 6 walkable
+                 blocked(nx, ny+1)));            // 7 blocked
+    }
+    
+    
+    // We really shouldn't be returning here, but to appease
+    // the compiler:
+    
+    return false;
+}
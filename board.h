@@ -1,21 +1,214 @@
 #ifndef __small_astartest__board__
 #define __small_astartest__board__
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
-#include "enums.h"
 #include "nodeID.h"
 
-struct cField {
-    cField():
-        status { cStatus::walkable },
-        marked { false } {}
-    
-    cStatus         status;
-    bool            marked;
-    int             whichList;
-    cNodeID         parent;
-    unsigned int    gScore;
-    unsigned int    hScore;
+// Fills in chunk (cx, cy) of a paged board (see cBoard): bit i of rows[j]
+// stands for tile (64 * cx + i, 64 * cy + j), and is set if the tile is
+// walkable. Bits past the edge of the board are ignored. Called with the
+// board's lock held, so never twice at once. May throw.
+typedef std::function<void(unsigned int cx, unsigned int cy, uint64_t* rows)> cChunkLoader;
+
+// The board: which tiles are walkable, and nothing else.
+//
+// Walkability is kept as a row-major bitset, one bit per tile, every row
+// padded to a whole number of 64 bit words; a set bit means "walkable".
+// So a blocked() probe touches a single word, and neighbouring tiles
+// share cache lines. Everything a search writes (g scores, parents,
+// open / closed flags) lives elsewhere, in flat arrays indexed by
+// index(x, y), so that the hot walkability data is never polluted by it.
+//
+// The same bits are also kept transposed, column by column, so that
+// vertical runs can be scanned a word (64 tiles) at a time just like
+// horizontal ones; see rowWord() and columnWord().
+//
+// A paged board is given a loader (see cChunkLoader) and a memory budget
+// instead, and keeps its bits in chunks of 64 x 64 tiles: a row of a
+// chunk is one word of a row, so rowWord() and columnWord() work the
+// same. Chunks are loaded when first touched, so a search over a huge
+// world only brings in what it gets to, and a chunk that's all walkable
+// or all blocked isn't stored at all: it points at one shared chunk of
+// each kind. trim() drops loaded chunks, oldest first, until the rest
+// fit the budget. Loading is locked, so any number of searches can run
+// at once, but trim(), like any edit, must not run while searches do:
+// until the next trim() the budget may be overrun. Edited chunks are
+// never dropped, since there's nowhere to write them back to.
+//
+// A board may also borrow its bits, row by row and column by column, laid
+// out just as a flat board keeps them, from memory it doesn't own, such as
+// a mapped snapshot (see snapshot.h); they must outlive the board. They're
+// only read: the first edit copies them, and the board works on its own
+// copy from then on.
+//
+// Only walkability is paged. The workspaces of the searches, and the
+// tables built over the board (JPS+, components, path tree, hierarchy),
+// are as big as the whole board, and building a table loads every chunk.
+
+class cBoard {
+public:
+    static const unsigned int chunkSize = 64;
+
+    cBoard(unsigned int width, unsigned int height);
+    cBoard(unsigned int width, unsigned int height, cChunkLoader, size_t budget);
+    cBoard(unsigned int width, unsigned int height, const uint64_t* rows, const uint64_t* columns);
+
+    unsigned int    width() const { return mWidth; }
+    unsigned int    height() const { return mHeight; }
+    size_t          size() const { return static_cast<size_t>(mWidth) * mHeight; }
+
+    bool            valid(long int x, long int y) const
+                    {
+                        return x >= 0 && x < mWidth && y >= 0 && y < mHeight;
+                    }
+
+    // Anything outside the board counts as blocked.
+    bool            blocked(long int x, long int y) const
+                    {
+                        if ( !valid(x, y) ) return true;
+                        return !((word(y, x >> 6) >> (x & 63)) & 1);
+                    }
+
+    // The same, for a board known to be W x H tiles at compile time
+    // (see searchKernel.h); the bounds and the row length fold into
+    // constants.
+    template <unsigned int W, unsigned int H>
+    bool            blocked(long int x, long int y) const
+                    {
+                        if ( x < 0 || x >= W || y < 0 || y >= H ) return true;
+                        auto w = mPaged ? chunk(x >> 6, y >> 6).rows[y & 63] :
+                                          mRows[y * ((W + 63) / 64) + (x >> 6)];
+                        return !((w >> (x & 63)) & 1);
+                    }
+
+    // Word k of row y: bit i stands for tile (64 * k + i, y). Rows and
+    // words outside the board read as all blocked, and so do the
+    // padding bits past the end of a row.
+    uint64_t        rowWord(long int y, long int k) const
+                    {
+                        if ( y < 0 || y >= mHeight || k < 0 || k >= mWordsPerRow ) return 0;
+                        return word(y, k);
+                    }
+
+    // Word k of column x: bit i stands for tile (x, 64 * k + i).
+    uint64_t        columnWord(long int x, long int k) const
+                    {
+                        if ( x < 0 || x >= mWidth || k < 0 || k >= mWordsPerColumn ) return 0;
+                        return mPaged ? chunk(x >> 6, k).columns[x & 63] :
+                                        mColumns[x * mWordsPerColumn + k];
+                    }
+
+    // Whether tiles x0..x1 of row y (either way round, inclusive) are all
+    // walkable; checked a word at a time. Anything off the board is not.
+    bool            clearRow(long int y, long int x0, long int x1) const;
+
+    // The same for tiles y0..y1 of column x.
+    bool            clearColumn(long int x, long int y0, long int y1) const;
+
+    unsigned int    index(long int x, long int y) const { return y * mWidth + x; }
+    cNodeID         node(unsigned int i) const { return cNodeID(i % mWidth, i / mWidth); }
+
+    bool            has_forced_neighbour(const cNodeID& id,
+                                         int dx,
+                                         int dy) const;
+
+    void            setBlocked(unsigned int x, unsigned int y, bool b);
+    void            toggle(unsigned int x, unsigned int y);
+    void            toggleArea(const cNodeID&, const cNodeID&);
+
+    // Paging; for a board that isn't paged, these do nothing, or tell
+    // of its one flat bitset.
+
+    // Drops loaded chunks over the budget. Before that, edited chunks
+    // that turned out uniform give up their bits, as on compact().
+    void            trim();
+
+    // Lets every edited chunk that's now all walkable or all blocked
+    // share the one chunk of its kind.
+    void            compact();
+
+    bool            paged() const { return mPaged; }
+    bool            borrowed() const { return !mPaged && mRows != mWalkable.data(); }
+    size_t          chunks() const { return static_cast<size_t>(mWordsPerRow) * mWordsPerColumn; }
+    size_t          storedChunks() const;       // with bits of their own
+    size_t          uniformChunks() const;
+    size_t          chunkLoads() const;         // from the loader, so far
+
+    // Bytes held by the bits, and by the bookkeeping of the chunks;
+    // borrowed bits don't count.
+    size_t          memoryUsage() const;
+
+private:
+    struct cChunk {
+        uint64_t    rows[64];
+        uint64_t    columns[64];
+    };
+
+    uint64_t        word(long int y, long int k) const
+                    {
+                        return mPaged ? chunk(k, y >> 6).rows[y & 63] : mRows[y * mWordsPerRow + k];
+                    }
+
+    // Chunk (cx, cy), loading it if need be.
+    const cChunk&   chunk(long int cx, long int cy) const
+                    {
+                        auto i = static_cast<size_t>(cy) * mWordsPerRow + cx;
+                        auto c = mChunks[i].load(std::memory_order_acquire);
+                        return c ? *c : load(i, cx, cy);
+                    }
+
+    const cChunk&   load(size_t i, long int cx, long int cy) const;
+
+    // Takes the rows of chunk i, as read: clears what's off the board,
+    // fills in the columns, and stores the bits, unless they're uniform.
+    const cChunk*   settle(size_t i, std::unique_ptr<cChunk>) const;
+
+    // The shared chunk with the same bits, if there's one.
+    static const cChunk* uniform(const cChunk&);
+
+    // The chunks that every all walkable or all blocked chunk shares.
+    static const cChunk&    uniformChunk(bool walkable);
+
+    // Copies borrowed bits, so that they can be edited.
+    void            own();
+
+    // Which bits of chunk i are on the board, by row and by column.
+    uint64_t        rowMask(size_t i) const;
+    uint64_t        columnMask(size_t i) const;
+
+private:
+    unsigned int            mWidth;
+    unsigned int            mHeight;
+    unsigned int            mWordsPerRow;       // chunks per row, when paged
+    unsigned int            mWordsPerColumn;    // chunks per column, when paged
+    bool                    mPaged;
+    std::vector<uint64_t>   mWalkable;          // row by row; empty when paged or borrowed
+    std::vector<uint64_t>   mWalkableT;         // column by column; ditto
+    const uint64_t*         mRows { nullptr };  // mWalkable's bits, or borrowed ones
+    const uint64_t*         mColumns { nullptr };
+
+    // By chunk index, row by row: the chunk's bits, which may be one of
+    // the shared uniform chunks; nullptr if not loaded.
+    std::unique_ptr<std::atomic<const cChunk*>[]>   mChunks;
+
+    // All of these only change with mLock held, or with no searches
+    // running.
+    cChunkLoader                                    mLoader;
+    size_t                                          mBudget { 0 };
+    mutable std::mutex                              mLock;
+    mutable std::vector<std::unique_ptr<cChunk>>    mStored;    // by chunk index
+    mutable std::deque<size_t>                      mLoaded;    // oldest first
+    mutable size_t                                  mStoredCount { 0 };
+    mutable size_t                                  mLoads { 0 };
+    std::vector<char>                               mEdited;    // by chunk index
+    bool                                            mEditedSinceCompact { false };
 };
 
 #endif /* defined(__small_astartest__board__) */
@@ -0,0 +1,219 @@
+#include "boardView.h"
+
+// 500: size of the view
+cBoardView::cBoardView(cPathFinder& p):
+mPathFinder { p },
+mTileSize { 500 / p.width(), 500 / p.height() },
+mBoardSize { p.width(), p.height() },
+mMarked(p.width() * p.height(), false),
+mWalked(p.width() * p.height(), false)
+{
+    for(auto j = 0; j < mBoardSize.y; ++j)
+        for(auto i = 0; i < mBoardSize.x; ++i)
+        {
+            float left = i * mTileSize.x;
+            float top = j * mTileSize.y;
+            mGrid.push_back(sf::Vertex(sf::Vector2f(left, top), sf::Color::White));
+            mGrid.push_back(sf::Vertex(sf::Vector2f(left + mTileSize.x, top), sf::Color::White));
+            mGrid.push_back(sf::Vertex(sf::Vector2f(left + mTileSize.x,
+                                                    top + mTileSize.y), sf::Color::White));
+            mGrid.push_back(sf::Vertex(sf::Vector2f(left, top + mTileSize.y), sf::Color::White));
+        }
+}
+
+// Attention. What we have here are screen coordinates!
+sf::Vector2i cBoardView::toTile(const sf::Vector2i& pos) const
+{
+    sf::Vector2i    tile;
+    tile.x = (mVc.x - (mVs.x / 2) + pos.x) / mTileSize.x;
+    tile.y = (mVc.y - (mVs.y / 2) + pos.y) / mTileSize.y;
+    return tile;
+}
+
+void cBoardView::setView(const sf::View& v)
+{
+    mVs = v.getSize();
+    mVc = v.getCenter();
+}
+
+void cBoardView::toggle(const sf::Vector2i& pos)
+{
+    auto tile = toTile(pos);
+    mPathFinder.toggle(tile.x, tile.y);
+}
+
+void cBoardView::startMarking(const sf::Vector2i& pos)
+{
+    auto tile = toTile(pos);
+    mMarkerStart.x = tile.x;
+    mMarkerStart.y = tile.y;
+    if ( mMarkerStart.x >= mBoardSize.x ) mMarkerStart.x = mBoardSize.x-1;
+    if ( mMarkerStart.y >= mBoardSize.y ) mMarkerStart.y = mBoardSize.y-1;
+    mMarkerNow = mMarkerStart;
+}
+
+void cBoardView::keepMarking(const sf::Vector2i& pos)
+{
+    auto tile = toTile(pos);
+    mMarkerNow.x = tile.x;
+    mMarkerNow.y = tile.y;
+
+    if ( mMarkerNow.x >= mBoardSize.x ) mMarkerNow.x = mBoardSize.x-1;
+    if ( mMarkerNow.y >= mBoardSize.y ) mMarkerNow.y = mBoardSize.y-1;
+
+    short int       stepx { 0 };
+    short int       stepy { 0 };
+
+    if (mMarkerNow.x > mMarkerStart.x) stepx = 1;
+    if (mMarkerNow.x < mMarkerStart.x) stepx = -1;
+
+    if (mMarkerNow.y > mMarkerStart.y ) stepy = 1;
+    if (mMarkerNow.y < mMarkerStart.y ) stepy = -1;
+
+    if (mMarkerNow.x == mMarkerStart.x && mMarkerNow.y == mMarkerStart.y)
+    {
+        mMarked[mMarkerNow.y * mBoardSize.x + mMarkerNow.x] = true;
+        return;
+    }
+
+    auto i = mMarkerStart.x;
+
+    do
+    {
+        auto j = mMarkerStart.y;
+        do
+        {
+            mMarked[j * mBoardSize.x + i] = true;
+            j += stepy;
+        } while (j != mMarkerNow.y + stepy);
+        i += stepx;
+    } while ( i != mMarkerNow.x + stepx );
+
+}
+
+void cBoardView::toggleMarkedOnes()
+{
+    mPathFinder.toggleArea(cNodeID(mMarkerStart.x, mMarkerStart.y),
+                           cNodeID(mMarkerNow.x, mMarkerNow.y));
+}
+
+bool cBoardView::tiles(const sf::Vector2i& from,
+                       const sf::Vector2i& to,
+                       cNodeID& start,
+                       cNodeID& goal) const
+{
+    if ( to.x > mBoardSize.x * mTileSize.x ||
+         to.y > mBoardSize.y * mTileSize.y ) return false;
+
+    auto sTile = toTile(from);
+    auto eTile = toTile(to);
+
+    if ( !mPathFinder.valid(sTile.x, sTile.y) ||
+         !mPathFinder.valid(eTile.x, eTile.y) ) return false;
+
+    if ( mPathFinder.blocked(sTile.x, sTile.y) ||
+         mPathFinder.blocked(eTile.x, eTile.y) ) return false;
+
+    start = cNodeID { sTile.x, sTile.y };
+    goal = cNodeID { eTile.x, eTile.y };
+    return true;
+}
+
+bool cBoardView::walk(const sf::Vector2i& from,
+                      const sf::Vector2i& to,
+                      bool cornercutting,
+                      bool smoothing)
+{
+    cNodeID start, goal;
+    if ( !tiles(from, to, start, goal) ) return false;
+
+    std::vector<cNodeID> path = mPathFinder.findPath(start, goal, cornercutting, smoothing);
+
+    if ( path.empty() ) return false;
+
+    for(auto&& i : path)
+        mWalked[i.y * mBoardSize.x + i.x] = true;
+
+    return true;
+}
+
+bool cBoardView::walk(cSearchHandle& search,
+                      const sf::Vector2i& from,
+                      const sf::Vector2i& to,
+                      bool cornercutting,
+                      bool smoothing,
+                      double micros)
+{
+    cNodeID start, goal;
+    if ( !tiles(from, to, start, goal) ) return false;
+
+    if ( search.state() == cSearchState::idle || search.state() == cSearchState::cancelled ||
+         search.start() != start || search.goal() != goal ||
+         search.cornerCutting() != cornercutting || search.smooth() != smoothing )
+        mPathFinder.beginSearch(search, start, goal, cornercutting, smoothing, true);
+
+    // A search that had finished only goes on if an edit restarts it.
+    bool searching = search.state() == cSearchState::running;
+    auto restarts = search.restarts();
+    auto state = mPathFinder.step(search, 0, micros);
+
+    for(auto&& i : search.path())
+        mWalked[i.y * mBoardSize.x + i.x] = true;
+
+    return state == cSearchState::found && (searching || search.restarts() != restarts);
+}
+
+void cBoardView::render(sf::RenderWindow& w)
+{
+
+    sf::Vector2i startTile;
+    startTile.x = (mVc.x - (mVs.x / 2)) / mTileSize.x;
+    startTile.y = (mVc.y - (mVs.y / 2)) / mTileSize.y;
+
+    sf::Vector2u tileCount;
+    tileCount.x = (mVs.x / mTileSize.x) + startTile.x + 2;
+    tileCount.y = (mVs.y / mTileSize.y) + startTile.y + 2;
+
+    if (tileCount.x > mBoardSize.x ) tileCount.x = mBoardSize.x;
+    if (tileCount.y > mBoardSize.y ) tileCount.y = mBoardSize.y;
+
+    sf::Color       tmpCol;
+    sf::Color       outCol;
+
+    auto row = tileCount.x - startTile.x;       // this many tiles in a single row
+
+    for(auto i = startTile.y; i < tileCount.y; ++i)
+        for(auto j = startTile.x; j < tileCount.x; ++j)
+        {
+            auto tile = i * mBoardSize.x + j;
+
+            // "Walked" and "marked" flags are automatically reset
+            // in each rendering turn.
+
+            if ( mWalked[tile] )
+            {
+                tmpCol = sf::Color::Red;
+                mWalked[tile] = false;
+            }
+            else if ( mPathFinder.blocked(j, i) )
+                tmpCol = sf::Color::Blue;
+            else
+                tmpCol = sf::Color::White;
+
+            if (mMarked[tile])
+            {
+                tmpCol.a = 120;
+                outCol = sf::Color::Cyan;
+                mMarked[tile] = false;
+            } else outCol = sf::Color::Black;
+
+            auto id = (4 * row) * i + ( 4 * j );
+
+            mGrid[id].color = tmpCol;
+            mGrid[id+1].color = tmpCol;
+            mGrid[id+2].color = tmpCol;
+            mGrid[id+3].color = tmpCol;
+        }
+
+    w.draw(&mGrid[0], mGrid.size(), sf::Quads);     // vertexarray, yay!
+}
@@ -0,0 +1,68 @@
+#ifndef __small_astartest__boardView__
+#define __small_astartest__boardView__
+
+#include "pathfinder.h"
+#include <SFML/Graphics.hpp>
+
+// The SFML side of the demo: draws a cPathFinder's board, translates
+// screen coordinates into tiles, and keeps track of the purely visual
+// state (tiles marked with the mouse, tiles on the last path found).
+// All the actual pathfinding is delegated to the cPathFinder.
+
+class cBoardView {
+public:
+    cBoardView(cPathFinder&);
+
+    void        render(sf::RenderWindow&);
+    void        setView(const sf::View&);
+
+    void        toggle(const sf::Vector2i&);
+
+    void        startMarking(const sf::Vector2i&);
+    void        keepMarking(const sf::Vector2i&);
+    void        toggleMarkedOnes();
+
+    bool        walk(const sf::Vector2i& from,
+                     const sf::Vector2i& to,
+                     bool cornercutting,
+                     bool smoothing);
+
+    // The same, spread over frames (see searchHandle.h): a new goal, or
+    // new settings, begin a new search, and each call runs it on for at
+    // most "micros" microseconds. Until the path is found, the one to the
+    // tile nearest the goal so far is shown. Returns true only from the
+    // call that finds it; the search's stats() tell how long that took
+    // over all.
+    bool        walk(cSearchHandle&,
+                     const sf::Vector2i& from,
+                     const sf::Vector2i& to,
+                     bool cornercutting,
+                     bool smoothing,
+                     double micros);
+
+private:
+    sf::Vector2i    toTile(const sf::Vector2i&) const;
+
+    // The tiles under the two screen positions; false if either is off
+    // the board, or blocked.
+    bool            tiles(const sf::Vector2i& from,
+                          const sf::Vector2i& to,
+                          cNodeID& start,
+                          cNodeID& goal) const;
+
+private:
+    cPathFinder&                        mPathFinder;
+
+    sf::Vector2u                        mTileSize;
+    sf::Vector2u                        mBoardSize;
+    sf::Vector2u                        mMarkerStart;
+    sf::Vector2u                        mMarkerNow;
+    sf::Vector2f                        mVs;    // view size
+    sf::Vector2f                        mVc;    // view center;
+
+    std::vector<bool>                   mMarked;    // indexed [y * width + x]
+    std::vector<bool>                   mWalked;    // ditto
+    std::vector<sf::Vertex>             mGrid;
+};
+
+#endif /* defined(__small_astartest__boardView__) */
@@ -0,0 +1,126 @@
+#include "bucketQueue.h"
+#include <stdexcept>
+
+const unsigned int cBucketQueue::initialBuckets;
+
+cBucketQueue::cBucketQueue(size_t cells):
+mBuckets(initialBuckets),
+mKey(cells),
+mQueued(cells, false),
+mMask { initialBuckets - 1 }
+{
+}
+
+void cBucketQueue::resize(size_t cells)
+{
+    clear();
+    mKey.resize(cells);
+    mQueued.assign(cells, false);
+}
+
+void cBucketQueue::push(unsigned int cell, unsigned int key)
+{
+    if ( mSize == 0 )
+    {
+        mCursor = key;
+        mHigh = key;
+    }
+    else
+    {
+        if ( key < mCursor ) mCursor = key;
+        if ( key > mHigh ) mHigh = key;
+        if ( mHigh - mCursor > mMask ) grow(mHigh - mCursor);
+    }
+
+    mBuckets[key & mMask].push_back(cell);
+    mKey[cell] = key;
+    if ( !mQueued[cell] )
+    {
+        mQueued[cell] = true;
+        ++mSize;
+    }
+    settle();
+}
+
+void cBucketQueue::decrease(unsigned int cell, unsigned int key)
+{
+    // The old entry stays where it is; since its key won't match
+    // mKey[cell] any more, it'll be dropped when its bucket comes up.
+    push(cell, key);
+}
+
+unsigned int cBucketQueue::top() const
+{
+    if ( mSize == 0 ) throw std::runtime_error("Trying to read from empty queue.");
+    return mBuckets[mCursor & mMask].back();
+}
+
+void cBucketQueue::pop()
+{
+    if ( mSize == 0 ) throw std::runtime_error("Trying to pop from empty queue.");
+    auto& bucket = mBuckets[mCursor & mMask];
+    mQueued[bucket.back()] = false;
+    bucket.pop_back();
+    --mSize;
+    settle();
+}
+
+unsigned int cBucketQueue::pop_and_get()
+{
+    auto ret = top();
+    pop();
+    return ret;
+}
+
+void cBucketQueue::clear()
+{
+    for ( auto& bucket : mBuckets )
+    {
+        for ( auto cell : bucket )
+            mQueued[cell] = false;
+        bucket.clear();                 // keeps the capacity for the next search
+    }
+    mSize = 0;
+    mCursor = 0;
+    mHigh = 0;
+}
+
+// Doubles the ring until a lap covers 'spread', and moves the live
+// entries over; stale ones are dropped on the way. An entry is live if
+// its cell is queued under a key that maps to the bucket it sits in
+// (a stale entry that passes this is only a harmless duplicate).
+void cBucketQueue::grow(unsigned int spread)
+{
+    auto size = mBuckets.size();
+    while ( size - 1 < spread ) size *= 2;
+
+    std::vector<std::vector<unsigned int>> buckets(size);
+    unsigned int mask = static_cast<unsigned int>(size - 1);
+    for ( size_t i = 0; i < mBuckets.size(); ++i )
+        for ( auto cell : mBuckets[i] )
+            if ( mQueued[cell] && (mKey[cell] & mMask) == i )
+                buckets[mKey[cell] & mask].push_back(cell);
+
+    mBuckets.swap(buckets);
+    mMask = mask;
+}
+
+// Throws away stale entries on top of the cursor's bucket, and
+// moves on to the next bucket when this one runs out. There's always
+// a live entry at or above the cursor while the queue isn't empty, and
+// since every queued key is within one lap of the cursor, an entry in
+// its bucket under any other key is stale.
+void cBucketQueue::settle()
+{
+    while ( mSize > 0 )
+    {
+        auto& bucket = mBuckets[mCursor & mMask];
+        while ( !bucket.empty() )
+        {
+            auto cell = bucket.back();
+            if ( mQueued[cell] && mKey[cell] == mCursor ) return;
+            bucket.pop_back();
+        }
+        ++mCursor;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __small_astartest__bucketQueue__
+#define __small_astartest__bucketQueue__
+
+#include <vector>
+#include <cstddef>
+
+// Bucket queue of board cells, keyed by small unsigned integers.
+//
+// All our scores are integers (10 for a straight step, 14 for a diagonal
+// one), so instead of keeping a heap ordered by comparisons, every key gets
+// a bucket of its own, and a cursor walks the buckets upward. push() is an
+// O(1) append; pop() takes from the cursor's bucket and only ever scans
+// forward over empty buckets, so a whole search costs O(pushes + the range
+// of f scores it spans). Keys smaller than the cursor are allowed (they
+// move the cursor back), so an inconsistent heuristic is handled correctly,
+// just less efficiently.
+//
+// The buckets form a ring, indexed by key modulo its size, so memory goes
+// with the spread of the keys queued at one time, not with the largest key
+// ever pushed. With a consistent heuristic and single steps that spread is
+// under 30; jumps and inconsistent keys may need more, in which case the
+// ring doubles until every queued key fits in one lap again.
+//
+// decrease() doesn't remove the old entry; it pushes the cell again under
+// its new key, and the stale copy is skipped when its bucket comes up.
+//
+// The interface is the same as cIndexedHeap's, so the two are
+// interchangeable as the open list of a search.
+
+class cBucketQueue {
+public:
+    explicit cBucketQueue(size_t cells = 0);
+
+    void            resize(size_t cells);
+
+    bool            empty() const { return mSize == 0; }
+    size_t          getSize() const { return mSize; }
+    bool            contains(unsigned int cell) const { return mQueued[cell]; }
+    unsigned int    key(unsigned int cell) const { return mKey[cell]; }
+
+    void            push(unsigned int cell, unsigned int key);
+    void            decrease(unsigned int cell, unsigned int key);
+    unsigned int    top() const;
+    unsigned int    topKey() const { return mCursor; }
+    void            pop();
+    unsigned int    pop_and_get();
+    void            clear();
+
+private:
+    void            settle();   // moves the cursor to the first live entry
+    void            grow(unsigned int spread);
+
+private:
+    std::vector<std::vector<unsigned int>>  mBuckets;   // mBuckets[key & mMask]: cells
+    std::vector<unsigned int>               mKey;       // per cell
+    std::vector<bool>                       mQueued;    // per cell
+    size_t                                  mSize { 0 };
+    unsigned int                            mMask;
+    unsigned int                            mCursor { 0 };  // no queued key is lower,
+    unsigned int                            mHigh { 0 };    // nor higher than this
+
+    static const unsigned int               initialBuckets = 64;
+};
+
+#endif /* defined(__small_astartest__bucketQueue__) */
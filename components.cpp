@@ -0,0 +1,321 @@
+#include "components.h"
+#include <algorithm>
+
+namespace {
+
+// Straight steps first, so that the first four are the 4-neighbourhood.
+const int steps[8][2] { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 },
+                        { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+
+unsigned int find(std::vector<unsigned int>& group, unsigned int i)
+{
+    while ( group[i] != i ) i = group[i] = group[group[i]];
+    return i;
+}
+
+}
+
+const unsigned int cComponents::npos;
+
+void cComponents::clear()
+{
+    mLabel.clear();
+    mLabel.shrink_to_fit();
+    mLabels = nullptr;
+    mSize.clear();
+    mFree.clear();
+    mStamp.clear();
+    mStamp.shrink_to_fit();
+    mOwner.clear();
+    mOwner.shrink_to_fit();
+    mCount = 0;
+    mBuilt = false;
+}
+
+unsigned int cComponents::newLabel()
+{
+    ++mCount;
+    if ( mFree.empty() )
+    {
+        mSize.push_back(0);
+        return static_cast<unsigned int>(mSize.size() - 1);
+    }
+
+    auto l = mFree.back();
+    mFree.pop_back();
+    return l;
+}
+
+void cComponents::freeLabel(unsigned int l)
+{
+    --mCount;
+    mSize[l] = 0;
+    mFree.push_back(l);
+}
+
+void cComponents::build(const cBoard& b, bool cornerCutting)
+{
+    mCornerCutting = cornerCutting;
+    mLabel.assign(b.size(), npos);
+    mLabels = mLabel.data();
+    mSize.clear();
+    mFree.clear();
+    mStamp.assign(b.size(), 0);
+    mOwner.assign(b.size(), 0);
+    mStampNow = 0;
+    mCount = 0;
+
+    std::vector<unsigned int> stack;
+    for ( unsigned int i = 0; i < b.size(); ++i )
+    {
+        auto id = b.node(i);
+        if ( mLabel[i] != npos || b.blocked(id.x, id.y) ) continue;
+
+        auto l = newLabel();
+        mLabel[i] = l;
+        stack.push_back(i);
+
+        while ( !stack.empty() )
+        {
+            auto u = b.node(stack.back());
+            stack.pop_back();
+            ++mSize[l];
+
+            for ( auto k = 0; k < neighbours(); ++k )
+            {
+                long x = u.x + steps[k][0], y = u.y + steps[k][1];
+                if ( b.blocked(x, y) ) continue;
+
+                auto n = b.index(x, y);
+                if ( mLabel[n] != npos ) continue;
+                mLabel[n] = l;
+                stack.push_back(n);
+            }
+        }
+    }
+
+    mBuilt = true;
+}
+
+void cComponents::relabel(const cBoard& b, unsigned int cell, unsigned int from, unsigned int to)
+{
+    std::vector<unsigned int> stack { cell };
+    mLabel[cell] = to;
+
+    while ( !stack.empty() )
+    {
+        auto u = b.node(stack.back());
+        stack.pop_back();
+
+        for ( auto k = 0; k < neighbours(); ++k )
+        {
+            long x = u.x + steps[k][0], y = u.y + steps[k][1];
+            if ( !b.valid(x, y) || mLabel[b.index(x, y)] != from ) continue;
+
+            mLabel[b.index(x, y)] = to;
+            stack.push_back(b.index(x, y));
+        }
+    }
+}
+
+void cComponents::join(const cBoard& b, unsigned int cell)
+{
+    auto id = b.node(cell);
+    auto best = npos;
+
+    for ( auto k = 0; k < neighbours(); ++k )
+    {
+        long x = id.x + steps[k][0], y = id.y + steps[k][1];
+        if ( !b.valid(x, y) ) continue;
+
+        auto l = mLabel[b.index(x, y)];
+        if ( l != npos && (best == npos || mSize[l] > mSize[best]) ) best = l;
+    }
+
+    if ( best == npos ) best = newLabel();
+    mLabel[cell] = best;
+    ++mSize[best];
+
+    for ( auto k = 0; k < neighbours(); ++k )
+    {
+        long x = id.x + steps[k][0], y = id.y + steps[k][1];
+        if ( !b.valid(x, y) ) continue;
+
+        auto l = mLabel[b.index(x, y)];
+        if ( l == npos || l == best ) continue;
+
+        mSize[best] += mSize[l];
+        relabel(b, b.index(x, y), l, best);
+        freeLabel(l);
+    }
+}
+
+bool cComponents::split(const cBoard& b, unsigned int label, const std::vector<unsigned int>& seeds)
+{
+    if ( seeds.size() < 2 ) return true;
+
+    if ( ++mStampNow == 0 )
+    {
+        std::fill(mStamp.begin(), mStamp.end(), 0);
+        mStampNow = 1;
+    }
+
+    // One fill per seed; fills that meet are joined in "group" (union-find).
+    auto fills = seeds.size();
+    std::vector<std::vector<unsigned int>>  reached(fills);
+    std::vector<size_t>                     next(fills, 0);
+    std::vector<unsigned int>               group(fills);
+
+    for ( unsigned int i = 0; i < fills; ++i )
+    {
+        group[i] = i;
+        auto s = seeds[i];
+        if ( mStamp[s] == mStampNow )
+        {
+            group[find(group, i)] = find(group, mOwner[s]);
+            continue;
+        }
+        mStamp[s] = mStampNow;
+        mOwner[s] = i;
+        reached[i].push_back(s);
+    }
+
+    size_t budget = std::max<size_t>(b.size() / 8, 1024);
+    size_t visited { 0 };
+
+    std::vector<char> spreading(fills);
+    while ( true )
+    {
+        // How many groups are there, and how many are still spreading?
+        std::fill(spreading.begin(), spreading.end(), 0);
+        size_t groups { 0 }, active { 0 };
+        for ( unsigned int i = 0; i < fills; ++i )
+        {
+            auto r = find(group, i);
+            if ( r == i ) ++groups;
+            if ( next[i] < reached[i].size() && !spreading[r] )
+            {
+                spreading[r] = 1;
+                ++active;
+            }
+        }
+        if ( groups == 1 ) return true;
+        if ( active <= 1 ) break;
+
+        for ( unsigned int i = 0; i < fills; ++i )
+        {
+            if ( next[i] == reached[i].size() ) continue;
+
+            auto u = b.node(reached[i][next[i]++]);
+            for ( auto k = 0; k < neighbours(); ++k )
+            {
+                long x = u.x + steps[k][0], y = u.y + steps[k][1];
+                if ( !b.valid(x, y) ) continue;
+
+                auto n = b.index(x, y);
+                if ( mLabel[n] != label ) continue;
+
+                if ( mStamp[n] == mStampNow )
+                    group[find(group, i)] = find(group, mOwner[n]);
+                else
+                {
+                    mStamp[n] = mStampNow;
+                    mOwner[n] = i;
+                    reached[i].push_back(n);
+                    ++visited;
+                }
+            }
+        }
+
+        if ( visited > budget ) return false;
+    }
+
+    // Every group that has run out is a component. The one still spreading
+    // (or, if none is, the biggest) keeps the old label.
+    std::vector<size_t> sizes(fills, 0);
+    for ( unsigned int i = 0; i < fills; ++i ) sizes[find(group, i)] += reached[i].size();
+
+    unsigned int keep = npos;
+    for ( unsigned int i = 0; i < fills; ++i )
+    {
+        if ( find(group, i) != i ) continue;
+        if ( spreading[i] ) { keep = i; break; }
+        if ( keep == npos || sizes[i] > sizes[keep] ) keep = i;
+    }
+
+    std::vector<unsigned int> labels(fills, npos);
+    for ( unsigned int i = 0; i < fills; ++i )
+    {
+        auto r = find(group, i);
+        if ( r == keep ) continue;
+
+        if ( labels[r] == npos )
+        {
+            labels[r] = newLabel();
+            mSize[labels[r]] = static_cast<unsigned int>(sizes[r]);
+            mSize[label] -= sizes[r];
+        }
+        for ( auto cell : reached[i] ) mLabel[cell] = labels[r];
+    }
+
+    return true;
+}
+
+void cComponents::update(const cBoard& b, const cNodeID& a, const cNodeID& c)
+{
+    if ( !mBuilt ) return;
+
+    if ( mLabels != mLabel.data() )
+    {
+        mLabel.assign(mLabels, mLabels + b.size());
+        mLabels = mLabel.data();
+        mStamp.assign(b.size(), 0);
+        mOwner.assign(b.size(), 0);
+    }
+
+    long left = std::max(0, std::min(a.x, c.x));
+    long top = std::max(0, std::min(a.y, c.y));
+    long right = std::min<long>(b.width() - 1, std::max(a.x, c.x));
+    long bottom = std::min<long>(b.height() - 1, std::max(a.y, c.y));
+
+    // Take out the tiles that became blocked, and note the ones that
+    // became walkable.
+    std::vector<unsigned int> lost;
+    std::vector<unsigned int> opened;
+    for ( auto y = top; y <= bottom; ++y )
+        for ( auto x = left; x <= right; ++x )
+        {
+            auto i = b.index(x, y);
+            bool blocked = b.blocked(x, y);
+
+            if ( blocked && mLabel[i] != npos )
+            {
+                auto l = mLabel[i];
+                mLabel[i] = npos;
+                if ( --mSize[l] == 0 ) freeLabel(l);
+                else if ( std::find(lost.begin(), lost.end(), l) == lost.end() ) lost.push_back(l);
+            }
+            else if ( !blocked && mLabel[i] == npos ) opened.push_back(i);
+        }
+
+    // Anything that came apart did so next to a tile taken out, so within
+    // the rectangle grown by one.
+    std::vector<unsigned int> seeds;
+    for ( auto l : lost )
+    {
+        if ( mSize[l] == 0 ) continue;
+
+        seeds.clear();
+        for ( auto y = std::max(0l, top - 1); y <= std::min<long>(b.height() - 1, bottom + 1); ++y )
+            for ( auto x = std::max(0l, left - 1); x <= std::min<long>(b.width() - 1, right + 1); ++x )
+                if ( mLabel[b.index(x, y)] == l ) seeds.push_back(b.index(x, y));
+
+        if ( !split(b, l, seeds) )
+        {
+            mBuilt = false;
+            return;
+        }
+    }
+
+    for ( auto i : opened ) join(b, i);
+}
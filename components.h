@@ -0,0 +1,107 @@
+#ifndef __small_astartest__components__
+#define __small_astartest__components__
+
+#include <vector>
+#include "board.h"
+#include "nodeID.h"
+
+// Connected components of the board's walkable tiles, so that a query
+// between two tiles that can't reach each other is turned down at once,
+// rather than after flooding everything the start can reach.
+//
+// What connects depends on corner cutting. Without it, a diagonal step
+// needs both tiles beside it free, so it never links anything that
+// straight steps don't: components are 4-connected. With it, they're
+// 8-connected. A labelling is made for one setting or the other, like
+// cJumpTable.
+//
+// Every tile carries the label of its component, and every label its
+// tile count. update() keeps them right as the board is edited:
+//
+//  - Merge: a tile that became walkable joins its neighbours' biggest
+//    component, and any other neighbouring component is relabelled into
+//    that one. Always the smaller into the bigger, so that no tile is
+//    relabelled more than O(log n) times.
+//  - Split: when tiles of a component become blocked, its tiles around
+//    the edit may have lost touch. A flood fill starts from each of them,
+//    one step per fill in turn, and fills that meet are merged. Once at
+//    most one group of them is still spreading, every group that has run
+//    out is a component of its own, and gets a new label. So the cost is
+//    in proportion to the smaller side of the split, not the whole
+//    component.
+//  - Fallback: if a split search grows past a budget (a big component
+//    cut through the middle), it gives up, and the labelling is marked
+//    out of date, to be rebuilt from scratch when next asked for.
+//
+// Labels restored from a snapshot (see snapshot.h) are read straight from
+// the mapped file, until the first update() copies them.
+
+class cComponents {
+public:
+    static const unsigned int npos = ~0u;
+
+    cComponents() { }
+
+    void        build(const cBoard&, bool cornerCutting);
+    void        clear();
+
+    // Built, and up to date with the board.
+    bool        built() const { return mBuilt; }
+    bool        cornerCutting() const { return mCornerCutting; }
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive); relabel what's affected, or give up.
+    void        update(const cBoard&, const cNodeID&, const cNodeID&);
+
+    // The label of the tile's component; npos for a blocked tile.
+    unsigned int label(const cBoard& b, const cNodeID& id) const
+                 {
+                     return b.valid(id.x, id.y) ? mLabels[b.index(id.x, id.y)] : npos;
+                 }
+
+    // Whether there's a path between the two tiles; both must be walkable.
+    bool        connected(const cBoard& b, const cNodeID& a, const cNodeID& c) const
+                {
+                    return label(b, a) == label(b, c);
+                }
+
+    size_t      count() const { return mCount; }
+
+private:
+    // Neighbours a single step away, straight ones first: 4 of them without
+    // corner cutting, 8 with.
+    int         neighbours() const { return mCornerCutting ? 8 : 4; }
+
+    unsigned int newLabel();
+    void        freeLabel(unsigned int);
+
+    // Gives the component of "cell" (labelled "from") the label "to".
+    void        relabel(const cBoard&, unsigned int cell, unsigned int from, unsigned int to);
+
+    // Tile "cell" has become walkable; join it up with its neighbours.
+    void        join(const cBoard&, unsigned int cell);
+
+    // Component "label" may have come apart around the given tiles.
+    // Returns false if it gave up.
+    bool        split(const cBoard&, unsigned int label, const std::vector<unsigned int>& seeds);
+
+private:
+    friend class cSnapshot;
+
+    std::vector<unsigned int>   mLabel;     // by cBoard::index
+    const unsigned int*         mLabels { nullptr };    // mLabel's, or mapped
+    std::vector<unsigned int>   mSize;      // by label; 0: not in use
+    std::vector<unsigned int>   mFree;      // labels not in use
+
+    // Scratch space of split(): which fill got to a tile first, if the
+    // tile's stamp is the current one.
+    std::vector<unsigned int>   mStamp;
+    std::vector<unsigned int>   mOwner;
+    unsigned int                mStampNow { 0 };
+
+    size_t                      mCount { 0 };
+    bool                        mBuilt { false };
+    bool                        mCornerCutting { false };
+};
+
+#endif /* defined(__small_astartest__components__) */
@@ -1,6 +1,31 @@
 #ifndef small_astartest_enums_h
 #define small_astartest_enums_h
 
-enum class cStatus { walkable, blocked, walked };
+// Which priority queue findPath uses as its open list: the indexed binary
+// heap (indexedHeap.h), or the bucket queue (bucketQueue.h).
+enum class cOpenList { binaryHeap, buckets };
+
+// The distance estimate of A* and JPS; see scoring.h. "manhattan" is the
+// original scoring, which may overestimate.
+enum class cHeuristic { octile, euclidean, chebyshev, manhattan };
+
+// Whether, and how, A* and JPS trade path length for speed; see
+// cPathFinder::mSuboptimal. With a weight w >= 1, paths cost at most w
+// times the shortest.
+//
+//  - weighted: weighted A*, which orders the open list by g + w * h.
+//  - focal: focal search. Of the open nodes whose g + h is within w times
+//    the lowest, the one with the lowest h, the closest to the goal by
+//    the estimate, is expanded next.
+//  - anytime: ARA*. A weighted A* with w first, then again with less and
+//    less weight, each round carrying on from where the last one left
+//    off, until the weight comes down to 1 or a budget runs out.
+enum class cSuboptimal { off, weighted, focal, anytime };
+
+// Where a time-sliced search stands; see searchHandle.h.
+enum class cSearchState { idle, running, found, noPath, cancelled };
+
+// The search that answers a query, as decided by the pathfinder's flags.
+enum class cEngine { aStar, jps, jpsPlus, hpa, pathTree, theta, lazyTheta };
 
 #endif
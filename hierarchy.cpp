@@ -0,0 +1,493 @@
+#include "hierarchy.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include "scoring.h"
+#include "threadPool.h"
+
+namespace {
+
+// Octile distance (see scoring.h). Never more than the real thing.
+unsigned int octile(const cNodeID& a, const cNodeID& b)
+{
+    return cOctileScoring::estimate(std::abs(a.x - b.x), std::abs(a.y - b.y));
+}
+
+}
+
+const unsigned int cHierarchy::npos;
+
+void cHierarchy::clear()
+{
+    mClusters.clear();
+    mEast.clear();
+    mSouth.clear();
+    mSouthEast.clear();
+    mSouthWest.clear();
+    mClustersX = mClustersY = 0;
+    mBuilt = false;
+}
+
+unsigned int cHierarchy::clusterOf(const cBoard& b, unsigned int cell) const
+{
+    auto n = b.node(cell);
+    return (n.y / mSize) * mClustersX + n.x / mSize;
+}
+
+unsigned int cHierarchy::localOf(const cBoard& b, unsigned int cluster, unsigned int cell) const
+{
+    auto n = b.node(cell);
+    return (n.y - cluster / mClustersX * mSize + 1) * stride() + (n.x - cluster % mClustersX * mSize + 1);
+}
+
+int cHierarchy::nodeOf(const cCluster& c, unsigned int cell) const
+{
+    auto it = std::find(c.nodes.begin(), c.nodes.end(), cell);
+    return it == c.nodes.end() ? -1 : static_cast<int>(it - c.nodes.begin());
+}
+
+cHierarchy::links cHierarchy::entrances(const cBoard& b, unsigned int cx, unsigned int cy, bool east) const
+{
+    links ret;
+    if ( east ? cx + 1 >= mClustersX : cy + 1 >= mClustersY ) return ret;
+
+    long int x0 = cx * mSize, y0 = cy * mSize;
+    long int w = std::min<long int>(mSize, b.width() - x0);
+    long int h = std::min<long int>(mSize, b.height() - y0);
+    long int length = east ? h : w;
+    int dx = east, dy = !east;
+
+    // The border runs along the last column (east) or row (south) of the
+    // cluster; tile i of it is open if both it and the tile across are.
+    auto tile = [&](long int i) { return east ? cNodeID(x0 + w - 1, y0 + i) : cNodeID(x0 + i, y0 + h - 1); };
+    auto open = [&](long int i)
+    {
+        auto t = tile(i);
+        return !b.blocked(t.x, t.y) && !b.blocked(t.x + dx, t.y + dy);
+    };
+    auto add = [&](long int i)
+    {
+        auto t = tile(i);
+        ret.emplace_back(b.index(t.x, t.y), b.index(t.x + dx, t.y + dy));
+    };
+
+    // With corner cutting, the two sides may also touch diagonally only:
+    // tile i here, and tile j = i +- 1 across, where neither tile i nor
+    // j can cross straight. (Where one of them can, the diagonal step
+    // leads to the same run as that straight one.)
+    auto addDiagonal = [&](long int i, long int j)
+    {
+        auto t = tile(i), u = tile(j);
+        if ( b.blocked(t.x, t.y) || b.blocked(u.x + dx, u.y + dy) ) return;
+        ret.emplace_back(b.index(t.x, t.y), b.index(u.x + dx, u.y + dy));
+    };
+
+    for ( long int i = 0; i < length; )
+    {
+        if ( !open(i) ) { ++i; continue; }
+
+        auto first = i;
+        while ( i < length && open(i) ) ++i;
+        auto last = i - 1;
+
+        // A short run gets one entrance in its middle; a long one gets
+        // one at either end, so that paths hugging a wall on either side
+        // don't have to detour to the middle.
+        if ( last - first < 5 ) add((first + last) / 2);
+        else
+        {
+            add(first);
+            add(last);
+        }
+    }
+
+    for ( long int i = 0; mCornerCutting && i + 1 < length; ++i )
+    {
+        if ( open(i) || open(i + 1) ) continue;
+        addDiagonal(i, i + 1);
+        addDiagonal(i + 1, i);
+    }
+    return ret;
+}
+
+cHierarchy::links cHierarchy::corner(const cBoard& b, unsigned int cx, unsigned int cy, bool east) const
+{
+    // Cluster (cx, cy) touches the one diagonally below it, to the east or
+    // the west, at a single pair of corner tiles. A diagonal step is the
+    // only way across there if the two tiles beside it are blocked; only
+    // corner cutting allows it then.
+    links ret;
+    if ( !mCornerCutting || cy + 1 >= mClustersY || (east ? cx + 1 >= mClustersX : cx == 0) ) return ret;
+
+    long int x = east ? std::min<long int>(b.width(), (cx + 1) * mSize) - 1 : cx * mSize;
+    long int y = std::min<long int>(b.height(), (cy + 1) * mSize) - 1;
+    int dx = east ? 1 : -1;
+
+    if ( !b.blocked(x, y) && !b.blocked(x + dx, y + 1) && b.blocked(x + dx, y) && b.blocked(x, y + 1) )
+        ret.emplace_back(b.index(x, y), b.index(x + dx, y + 1));
+    return ret;
+}
+
+void cHierarchy::load(const cBoard& b, cWorkspace& ws, unsigned int cluster) const
+{
+    long int x0 = cluster % mClustersX * mSize, y0 = cluster / mClustersX * mSize;
+    long int x1 = std::min<long int>(x0 + mSize, b.width());
+    long int y1 = std::min<long int>(y0 + mSize, b.height());
+
+    auto& grid = ws.mLocalWalkable;
+    grid.assign(stride() * stride(), 0);
+    for ( auto y = y0; y < y1; ++y )
+        for ( auto x = x0; x < x1; ++x )
+            grid[(y - y0 + 1) * stride() + (x - x0 + 1)] = !b.blocked(x, y);
+}
+
+void cHierarchy::explore(const cBoard& b, cWorkspace& ws, unsigned int cluster, unsigned int cell,
+                         const unsigned int* targets, size_t count) const
+{
+    const int st = stride();
+
+    auto& grid = ws.mLocalWalkable;
+    auto& target = ws.mLocalTarget;
+    auto& dist = ws.mLocalDist;
+    auto& parent = ws.mLocalParent;
+    auto& open = ws.mLocalOpen;
+
+    if ( dist.size() != grid.size() )
+    {
+        dist.resize(grid.size());
+        parent.resize(grid.size());
+        open.resize(grid.size());
+        target.assign(grid.size(), 0);
+    }
+    std::fill(dist.begin(), dist.end(), npos);
+
+    size_t left { 0 };
+    for ( size_t i = 0; i < count; ++i )
+    {
+        auto t = localOf(b, cluster, targets[i]);
+        if ( !target[t] ) ++left;
+        target[t] = 1;
+    }
+
+    auto s = localOf(b, cluster, cell);
+    dist[s] = 0;
+    parent[s] = s;
+    open.push(s, 0);
+    SEARCH_STAT(++ws.mStats.pushes);
+
+    while ( !open.empty() )
+    {
+        int u = open.pop_and_get();
+        SEARCH_STAT(++ws.mStats.expanded);
+        if ( target[u] )
+        {
+            target[u] = 0;
+            if ( --left == 0 ) break;
+        }
+
+        // Same moves as cPathFinder::adjacent(); the frame keeps us inside.
+        for ( auto dy = -1; dy < 2; ++dy )
+            for ( auto dx = -1; dx < 2; ++dx )
+            {
+                auto v = u + dy * st + dx;
+                if ( v == u || !grid[v] ) continue;
+                if ( dx != 0 && dy != 0 && !mCornerCutting &&
+                     (!grid[u + dx] || !grid[u + dy * st]) ) continue;
+
+                auto d = dist[u] + (dx != 0 && dy != 0 ? 14 : 10);
+                if ( d >= dist[v] ) continue;
+
+                dist[v] = d;
+                parent[v] = u;
+                if ( open.contains(v) )
+                {
+                    open.decrease(v, d);
+                    SEARCH_STAT(++ws.mStats.decreases);
+                }
+                else
+                {
+                    open.push(v, d);
+                    SEARCH_STAT(++ws.mStats.pushes);
+                }
+            }
+    }
+
+    open.clear();
+    if ( left > 0 )     // some were out of reach; unmark them
+        for ( size_t i = 0; i < count; ++i )
+            target[localOf(b, cluster, targets[i])] = 0;
+}
+
+void cHierarchy::refine(const cBoard& b, cWorkspace& ws, unsigned int cluster,
+                        unsigned int from, unsigned int to,
+                        std::vector<cNodeID>& path) const
+{
+    load(b, ws, cluster);
+    explore(b, ws, cluster, from, &to, 1);
+
+    long int x0 = cluster % mClustersX * mSize, y0 = cluster / mClustersX * mSize;
+    auto first = path.size();
+    auto s = localOf(b, cluster, from);
+
+    for ( auto l = localOf(b, cluster, to); l != s; l = ws.mLocalParent[l] )
+        path.push_back(cNodeID(x0 + l % stride() - 1, y0 + l / stride() - 1));
+
+    std::reverse(path.begin() + first, path.end());
+}
+
+void cHierarchy::rebuild(const cBoard& b, cWorkspace& ws, unsigned int k)
+{
+    cCluster c;
+
+    auto add = [&](unsigned int tile, unsigned int other)
+    {
+        auto i = nodeOf(c, tile);
+        if ( i < 0 )
+        {
+            i = static_cast<int>(c.nodes.size());
+            c.nodes.push_back(tile);
+        }
+        c.across.emplace_back(i, other);
+    };
+
+    for ( auto& e : mEast[k] ) add(e.first, e.second);
+    for ( auto& e : mSouth[k] ) add(e.first, e.second);
+    if ( k % mClustersX > 0 ) for ( auto& e : mEast[k - 1] ) add(e.second, e.first);
+    if ( k / mClustersX > 0 ) for ( auto& e : mSouth[k - mClustersX] ) add(e.second, e.first);
+    for ( auto& e : mSouthEast[k] ) add(e.first, e.second);
+    for ( auto& e : mSouthWest[k] ) add(e.first, e.second);
+    if ( k / mClustersX > 0 && k % mClustersX > 0 )
+        for ( auto& e : mSouthEast[k - mClustersX - 1] ) add(e.second, e.first);
+    if ( k / mClustersX > 0 && k % mClustersX + 1 < mClustersX )
+        for ( auto& e : mSouthWest[k - mClustersX + 1] ) add(e.second, e.first);
+
+    // Distances are symmetric, so each search only needs to find the
+    // nodes after its own.
+    auto n = c.nodes.size();
+    c.dist.assign(n * n, 0);
+    load(b, ws, k);
+    for ( size_t i = 0; i + 1 < n; ++i )
+    {
+        explore(b, ws, k, c.nodes[i], &c.nodes[i + 1], n - i - 1);
+        for ( auto j = i + 1; j < n; ++j )
+            c.dist[i * n + j] = c.dist[j * n + i] = ws.mLocalDist[localOf(b, k, c.nodes[j])];
+    }
+
+    mClusters[k] = std::move(c);
+}
+
+void cHierarchy::build(const cBoard& b, bool cornerCutting, unsigned int clusterSize)
+{
+    if ( clusterSize == 0 )
+        throw std::runtime_error("Cluster size must be positive.");
+
+    mSize = clusterSize;
+    mCornerCutting = cornerCutting;
+    mClustersX = (b.width() + mSize - 1) / mSize;
+    mClustersY = (b.height() + mSize - 1) / mSize;
+
+    auto count = mClustersX * mClustersY;
+    mEast.assign(count, links { });
+    mSouth.assign(count, links { });
+    mSouthEast.assign(count, links { });
+    mSouthWest.assign(count, links { });
+    mClusters.assign(count, cCluster { });
+
+    parallelFor(count, [&](size_t k)
+    {
+        mEast[k] = entrances(b, k % mClustersX, k / mClustersX, true);
+        mSouth[k] = entrances(b, k % mClustersX, k / mClustersX, false);
+        mSouthEast[k] = corner(b, k % mClustersX, k / mClustersX, true);
+        mSouthWest[k] = corner(b, k % mClustersX, k / mClustersX, false);
+    });
+
+    // A row of clusters at a time, each with a scratch workspace of its own.
+    parallelFor(mClustersY, [&](size_t cy)
+    {
+        cWorkspace scratch { 0 };
+        for ( auto cx = 0u; cx < mClustersX; ++cx )
+            rebuild(b, scratch, cy * mClustersX + cx);
+    }, 1);
+
+    mBuilt = true;
+}
+
+void cHierarchy::update(const cBoard& b, const cNodeID& c1, const cNodeID& c2)
+{
+    if ( !mBuilt ) return;
+
+    unsigned int left = std::max(0, std::min(c1.x, c2.x)) / mSize;
+    unsigned int right = std::min<long int>(b.width() - 1, std::max(c1.x, c2.x)) / mSize;
+    unsigned int top = std::max(0, std::min(c1.y, c2.y)) / mSize;
+    unsigned int bottom = std::min<long int>(b.height() - 1, std::max(c1.y, c2.y)) / mSize;
+
+    // Every touched cluster has to be rebuilt. So does a neighbour, but
+    // only if the entrances on the border they share have changed.
+    std::vector<unsigned int> dirty;
+
+    auto redo = [&](unsigned int owner, unsigned int other, bool east)
+    {
+        auto& side = east ? mEast[owner] : mSouth[owner];
+        auto fresh = entrances(b, owner % mClustersX, owner / mClustersX, east);
+        if ( fresh == side ) return;
+        side = std::move(fresh);
+        dirty.push_back(owner);
+        dirty.push_back(other);
+    };
+
+    // A corner link depends on a tile in each of four clusters, so every
+    // corner around the touched clusters is looked at again.
+    auto redoCorner = [&](unsigned int cx, unsigned int cy, bool east)
+    {
+        auto owner = cy * mClustersX + cx;
+        auto& side = east ? mSouthEast[owner] : mSouthWest[owner];
+        auto fresh = corner(b, cx, cy, east);
+        if ( fresh == side ) return;
+        side = std::move(fresh);
+        dirty.push_back(owner);
+        dirty.push_back(owner + mClustersX + (east ? 1 : -1));
+    };
+
+    for ( auto cy = top > 0 ? top - 1 : 0; cy <= bottom; ++cy )
+        for ( auto cx = left > 0 ? left - 1 : 0; cx <= std::min(right + 1, mClustersX - 1); ++cx )
+        {
+            redoCorner(cx, cy, true);
+            redoCorner(cx, cy, false);
+        }
+
+    for ( auto cy = top; cy <= bottom; ++cy )
+        for ( auto cx = left; cx <= right; ++cx )
+        {
+            auto k = cy * mClustersX + cx;
+            dirty.push_back(k);
+            if ( cx + 1 < mClustersX ) redo(k, k + 1, true);
+            if ( cy + 1 < mClustersY ) redo(k, k + mClustersX, false);
+            if ( cx > 0 ) redo(k - 1, k, true);
+            if ( cy > 0 ) redo(k - mClustersX, k, false);
+        }
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    cWorkspace scratch { 0 };
+    for ( auto k : dirty )
+        rebuild(b, scratch, k);
+}
+
+std::vector<cNodeID> cHierarchy::findPath(const cBoard& b,
+                                          cWorkspace& ws,
+                                          const cNodeID& start,
+                                          const cNodeID& goal) const
+{
+    std::vector<cNodeID> path;
+
+    auto s = b.index(start.x, start.y), g = b.index(goal.x, goal.y);
+    auto cs = clusterOf(b, s), cg = clusterOf(b, g);
+    auto uid = ws.UID;
+    auto& open = ws.mHeap;
+    cStatTimer searching { ws.mStats.searchMicros };
+
+    // The abstract search keeps its scores in the workspace's per-cell
+    // arrays, just like the flat one; only entrance tiles and the goal
+    // ever get there.
+    auto relax = [&](unsigned int cell, unsigned int gScore, unsigned int parent)
+    {
+        if ( ws.mWhichList[cell] == -uid ) return;
+        auto f = gScore + octile(b.node(cell), goal);
+        if ( ws.mWhichList[cell] == uid )
+        {
+            if ( gScore >= ws.mGscore[cell] ) return;
+            open.decrease(cell, f);
+            SEARCH_STAT(++ws.mStats.decreases);
+        }
+        else
+        {
+            ws.mWhichList[cell] = uid;
+            open.push(cell, f);
+            SEARCH_STAT(++ws.mStats.pushes);
+        }
+        ws.mGscore[cell] = gScore;
+        ws.mParent[cell] = parent;
+    };
+
+    // Hook the start up to the nodes of its cluster. These are the roots
+    // of the search (their own parents). If the goal is in the same
+    // cluster, it may be reachable directly as well.
+    load(b, ws, cs);
+    explore(b, ws, cs, s);
+    for ( auto n : mClusters[cs].nodes )
+    {
+        auto d = ws.mLocalDist[localOf(b, cs, n)];
+        if ( d != npos ) relax(n, d, n);
+    }
+    if ( cs == cg )
+    {
+        auto d = ws.mLocalDist[localOf(b, cs, g)];
+        if ( d != npos ) relax(g, d, g);
+    }
+
+    // ... and the goal to the nodes of its own.
+    load(b, ws, cg);
+    explore(b, ws, cg, g);
+    auto& toGoal = ws.mGoalDist;
+    toGoal.clear();
+    for ( auto n : mClusters[cg].nodes )
+        toGoal.push_back(ws.mLocalDist[localOf(b, cg, n)]);
+
+    while ( !open.empty() )
+    {
+        auto u = open.pop_and_get();
+        SEARCH_STAT(++ws.mStats.expanded);
+        ws.mWhichList[u] = -uid;
+        if ( u == g ) break;
+
+        // Anything else on the open list is an entrance tile.
+        auto k = clusterOf(b, u);
+        auto& c = mClusters[k];
+        size_t i = nodeOf(c, u);
+        auto n = c.nodes.size();
+        auto gu = ws.mGscore[u];
+
+        for ( size_t j = 0; j < n; ++j )
+            if ( j != i && c.dist[i * n + j] != npos )
+                relax(c.nodes[j], gu + c.dist[i * n + j], u);
+
+        // A straight step across the border, or a diagonal one.
+        for ( auto& a : c.across )
+            if ( a.first == i ) relax(a.second, gu + octile(b.node(u), b.node(a.second)), u);
+
+        if ( k == cg && toGoal[i] != npos )
+            relax(g, gu + toGoal[i], u);
+    }
+
+    open.clear();
+    searching.stop();
+    if ( ws.mWhichList[g] != -uid ) return path;
+
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
+
+    // The abstract path, root first, with the start in front of it...
+    std::vector<unsigned int> chain;
+    for ( auto c = g; ; c = ws.mParent[c] )
+    {
+        chain.push_back(c);
+        if ( ws.mParent[c] == c ) break;
+    }
+    chain.push_back(s);
+    std::reverse(chain.begin(), chain.end());
+
+    // ... then refined, edge by edge: within a cluster with a local
+    // search, across a border with a single step.
+    path.push_back(start);
+    for ( size_t i = 1; i < chain.size(); ++i )
+    {
+        auto from = chain[i - 1], to = chain[i];
+        if ( from == to ) continue;
+
+        auto k = clusterOf(b, from);
+        if ( k == clusterOf(b, to) ) refine(b, ws, k, from, to, path);
+        else path.push_back(b.node(to));
+    }
+
+    return path;
+}
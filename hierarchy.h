@@ -0,0 +1,125 @@
+#ifndef __small_astartest__hierarchy__
+#define __small_astartest__hierarchy__
+
+#include <utility>
+#include <vector>
+#include "board.h"
+#include "nodeID.h"
+#include "workspace.h"
+
+// HPA*: hierarchical pathfinding on an abstract graph of the board.
+//
+// The board is cut into square clusters. Wherever two neighbouring
+// clusters touch along a run of tiles that are walkable on both sides,
+// there's an entrance: one pair of tiles in the middle of the run, or two
+// (one at either end) if the run is long. The tiles of all entrances are
+// the nodes of the abstract graph. Each node is linked to its partner
+// across the border (one step), and to every other node of its
+// own cluster that it can reach without leaving the cluster. The length of
+// that shortest path is stored in a per-cluster distance matrix.
+//
+// To answer a query, the start and the goal are connected to the nodes
+// of their clusters. Then A* runs on the abstract graph, and each
+// abstract edge is refined into tiles with a search inside its cluster.
+// The abstract graph has far fewer nodes than the board has tiles,
+// especially on boards of rooms and corridors. The price: paths are
+// optimal within each cluster, but only cross borders at entrances, so
+// they aren't always optimal overall.
+//
+// With corner cutting, two clusters may also touch where only a diagonal
+// step gets across: beside a straight entrance that's never needed, but
+// where two tiles block the way, the tiles of the diagonal step make an
+// entrance of their own. So do the corner tiles of clusters diagonally
+// next to each other.
+//
+// Distances depend on whether corner cutting is allowed, so a hierarchy
+// is built for one setting or the other, like cJumpTable. When the board
+// is edited, update() rebuilds only the clusters the edit touched, plus
+// any neighbour whose shared entrances changed.
+//
+// A snapshot (see snapshot.h) keeps the whole graph, which is copied back
+// in when the snapshot is opened: much quicker than building it, but
+// unlike the board and the other tables, not free.
+
+class cHierarchy {
+public:
+    cHierarchy() { }
+
+    void        build(const cBoard&, bool cornerCutting, unsigned int clusterSize = 32);
+    void        clear();
+
+    bool        built() const { return mBuilt; }
+    bool        cornerCutting() const { return mCornerCutting; }
+    unsigned int clusterSize() const { return mSize; }
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive); rebuild what's affected.
+    void        update(const cBoard&, const cNodeID&, const cNodeID&);
+
+    // Tile by tile path from start to goal, not smoothed; empty if there's
+    // none. Both ends must be walkable. Only reads the hierarchy, so it's
+    // safe to call from several threads, each with its own workspace.
+    std::vector<cNodeID> findPath(const cBoard&,
+                                  cWorkspace&,
+                                  const cNodeID& start,
+                                  const cNodeID& goal) const;
+
+private:
+    // (tile on this side, tile on the other side), as board indices
+    typedef std::vector<std::pair<unsigned int, unsigned int>>  links;
+
+    struct cCluster {
+        std::vector<unsigned int>   nodes;  // board indices of its entrance tiles
+        std::vector<unsigned int>   dist;   // nodes x nodes; npos: can't get there
+        links                       across; // (index into nodes, tile over the border)
+    };
+
+    static const unsigned int npos = ~0u;
+
+    // Searches within a cluster work on a copy of its walkability, with a
+    // frame of blocked tiles around it: (mSize + 2) tiles square. localOf()
+    // is a board cell's index in that.
+    int             stride() const { return mSize + 2; }
+    unsigned int    clusterOf(const cBoard& b, unsigned int cell) const;
+    unsigned int    localOf(const cBoard& b, unsigned int cluster, unsigned int cell) const;
+    int             nodeOf(const cCluster&, unsigned int cell) const;
+
+    // Entrances on the east / south side of cluster (cx, cy).
+    links           entrances(const cBoard&, unsigned int cx, unsigned int cy, bool east) const;
+    // The diagonal link, if any, between cluster (cx, cy) and the one
+    // below and to the east / west of it.
+    links           corner(const cBoard&, unsigned int cx, unsigned int cy, bool east) const;
+    void            rebuild(const cBoard&, cWorkspace&, unsigned int cluster);
+
+    // Copies the cluster's walkability into ws.mLocalWalkable.
+    void            load(const cBoard&, cWorkspace&, unsigned int cluster) const;
+
+    // Dijkstra from cell, without leaving the cluster last load()-ed. Leaves
+    // distances and parents in ws.mLocalDist and ws.mLocalParent, by
+    // localOf(). Given target cells, it stops as soon as all of them are
+    // settled; other distances may then not be final.
+    void            explore(const cBoard&, cWorkspace&, unsigned int cluster, unsigned int cell,
+                            const unsigned int* targets = nullptr, size_t count = 0) const;
+
+    // Appends the tiles after "from", up to and including "to", both in
+    // the given cluster, along a shortest path within it.
+    void            refine(const cBoard&, cWorkspace&, unsigned int cluster,
+                           unsigned int from, unsigned int to,
+                           std::vector<cNodeID>& path) const;
+
+private:
+    friend class cSnapshot;
+
+    std::vector<cCluster>   mClusters;      // row by row
+    std::vector<links>      mEast;          // per cluster: entrances to the one on its right
+    std::vector<links>      mSouth;         // ... and to the one below it
+    std::vector<links>      mSouthEast;     // ... and diagonally below, to the right
+    std::vector<links>      mSouthWest;     // ... and to the left
+    unsigned int            mSize { 32 };   // cluster side, in tiles
+    unsigned int            mClustersX { 0 };
+    unsigned int            mClustersY { 0 };
+    bool                    mBuilt { false };
+    bool                    mCornerCutting { false };
+};
+
+#endif /* defined(__small_astartest__hierarchy__) */
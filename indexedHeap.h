@@ -0,0 +1,84 @@
+#ifndef __small_astartest__indexedHeap__
+#define __small_astartest__indexedHeap__
+
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+// Indexed D-ary min-heap of board cells.
+//
+// Items are cell indices (see cBoard::index), each with a key: an unsigned
+// int, unless Key says otherwise. The item with the smallest key is on
+// top. Unlike cPQ, every cell remembers its own slot in the heap, so
+// lowering the key of a cell that's already queued is a simple sift-up
+// from that slot: O(log n), with no searching involved. The price is one
+// slot per cell on the board, which is why the heap has to be told the
+// number of cells up front.
+//
+// D is the number of children per node. 2 gives a plain binary heap,
+// which is what measured fastest on our boards; a wider heap is shallower,
+// but has to compare more children on every level of pop().
+//
+// Among equal keys, the most recently pushed or decreased cell tends to
+// come out first, like in cBucketQueue. With an exact heuristic, that
+// keeps a search going along one of the many equally good paths instead
+// of expanding all of them.
+
+// Key interface:
+// cIndexedHeap(cells) : constructs an empty heap for cells 0 .. cells-1
+// cells()             : that number
+// push(cell, key)     : cell must not be on the heap yet
+// decrease(cell, key) : cell must be on the heap, key must not be larger
+// update(cell, key)   : cell must be on the heap; any key
+// remove(cell)        : cell must be on the heap
+// top(), topKey()     : the cell with the smallest key, and its key
+// pop(), pop_and_get()
+// clear()             : empties the heap in O(number of queued cells)
+
+template <unsigned int D = 2, typename Key = unsigned int>
+class cIndexedHeap {
+public:
+    static const unsigned int npos = ~0u;
+
+    explicit cIndexedHeap(size_t cells = 0):
+    mSlot(cells, npos),
+    mKey(cells)
+    {
+    }
+
+    void            resize(size_t cells);
+    size_t          cells() const { return mSlot.size(); }
+
+    bool            empty() const { return mHeap.empty(); }
+    size_t          getSize() const { return mHeap.size(); }
+    bool            contains(unsigned int cell) const { return mSlot[cell] != npos; }
+    Key             key(unsigned int cell) const { return mKey[cell]; }
+
+    void            push(unsigned int cell, Key key);
+    void            decrease(unsigned int cell, Key key);
+    void            update(unsigned int cell, Key key);
+    void            remove(unsigned int cell);
+    unsigned int    top() const;
+    Key             topKey() const { return mKey[top()]; }
+    void            pop();
+    unsigned int    pop_and_get();
+    void            clear();
+
+private:
+    void            place(size_t slot, unsigned int cell)
+                    {
+                        mHeap[slot] = cell;
+                        mSlot[cell] = static_cast<unsigned int>(slot);
+                    }
+    void            swim(size_t slot);
+    void            sink(size_t slot);
+
+private:
+    std::vector<unsigned int>   mHeap;  // the heap proper: cells, root at 0
+    std::vector<unsigned int>   mSlot;  // per cell: where it is in mHeap, or npos
+    std::vector<Key>            mKey;   // per cell: its key, if it's on the heap
+};
+
+#include "indexedHeap.inl"
+
+#endif /* defined(__small_astartest__indexedHeap__) */
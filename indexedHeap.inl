@@ -0,0 +1,131 @@
+template <unsigned int D, typename Key>
+const unsigned int cIndexedHeap<D, Key>::npos;
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::resize(size_t cells)
+{
+    clear();
+    mSlot.assign(cells, npos);
+    mKey.resize(cells);
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::push(unsigned int cell, Key key)
+{
+    mKey[cell] = key;
+    mHeap.push_back(cell);
+    mSlot[cell] = static_cast<unsigned int>(mHeap.size() - 1);
+    swim(mHeap.size() - 1);
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::decrease(unsigned int cell, Key key)
+{
+    mKey[cell] = key;
+    swim(mSlot[cell]);
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::update(unsigned int cell, Key key)
+{
+    auto old = mKey[cell];
+    mKey[cell] = key;
+    if ( key < old ) swim(mSlot[cell]);
+    else sink(mSlot[cell]);
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::remove(unsigned int cell)
+{
+    auto slot = mSlot[cell];
+    mSlot[cell] = npos;
+
+    // The last item takes the hole, and moves up or down from there.
+    auto last = mHeap.back();
+    mHeap.pop_back();
+    if ( slot == mHeap.size() ) return;
+
+    place(slot, last);
+    if ( slot > 0 && mKey[last] < mKey[mHeap[(slot - 1) / D]] ) swim(slot);
+    else sink(slot);
+}
+
+template <unsigned int D, typename Key>
+unsigned int cIndexedHeap<D, Key>::top() const
+{
+    if ( mHeap.empty() ) throw std::runtime_error("Trying to read from empty heap.");
+    return mHeap[0];
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::pop()
+{
+    if ( mHeap.empty() ) throw std::runtime_error("Trying to pop from empty heap.");
+    mSlot[mHeap[0]] = npos;
+
+    // Move the last item to the top, and let it sink to where it belongs.
+    auto last = mHeap.back();
+    mHeap.pop_back();
+    if ( !mHeap.empty() )
+    {
+        place(0, last);
+        sink(0);
+    }
+}
+
+template <unsigned int D, typename Key>
+unsigned int cIndexedHeap<D, Key>::pop_and_get()
+{
+    auto ret = top();
+    pop();
+    return ret;
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::clear()
+{
+    for ( auto cell : mHeap )
+        mSlot[cell] = npos;
+    mHeap.clear();      // keeps the capacity for the next search
+}
+
+// The moving item is held aside while its parents are shifted down,
+// instead of being swapped at every level.
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::swim(size_t slot)
+{
+    auto cell = mHeap[slot];
+    auto key = mKey[cell];
+    while ( slot > 0 )
+    {
+        auto parent = (slot - 1) / D;
+        if ( mKey[mHeap[parent]] < key ) break;
+        place(slot, mHeap[parent]);
+        slot = parent;
+    }
+    place(slot, cell);
+}
+
+template <unsigned int D, typename Key>
+void cIndexedHeap<D, Key>::sink(size_t slot)
+{
+    auto cell = mHeap[slot];
+    auto key = mKey[cell];
+    auto size = mHeap.size();
+    while ( true )
+    {
+        auto first = slot * D + 1;
+        if ( first >= size ) break;
+
+        // Find the smallest of the (at most) D children.
+        auto last = first + D < size ? first + D : size;
+        auto best = first;
+        for ( auto i = first + 1; i < last; ++i )
+            if ( mKey[mHeap[i]] < mKey[mHeap[best]] ) best = i;
+
+        if ( key <= mKey[mHeap[best]] ) break;
+        place(slot, mHeap[best]);
+        slot = best;
+    }
+    place(slot, cell);
+}
@@ -0,0 +1,211 @@
+#include "jumpTable.h"
+#include <algorithm>
+#include <stdexcept>
+#include "threadPool.h"
+
+namespace {
+
+const int diagonals[4][2] { { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+const int straights[4][2] { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 } };
+
+}
+
+void cJumpTable::clear()
+{
+    mDist.clear();
+    mDist.shrink_to_fit();
+    mTable = nullptr;
+    mBuilt = false;
+}
+
+int16_t cJumpTable::compute(const cBoard& b, long int x, long int y, int dx, int dy) const
+{
+    auto nx = x + dx, ny = y + dy;
+
+    if ( b.blocked(nx, ny) ) return 0;
+
+    if ( dx == 0 || dy == 0 )
+    {
+        if ( b.has_forced_neighbour(cNodeID(nx, ny), dx, dy) ) return 1;
+    }
+    else
+    {
+        if ( !mCornerCutting && b.blocked(nx + dx, ny) && b.blocked(nx, ny + dy) ) return 0;
+
+        // A diagonal stops wherever one of its straight scan lines would.
+        if ( b.has_forced_neighbour(cNodeID(nx, ny), dx, dy) ||
+             at(b, nx, ny, 0, dy) > 0 ||
+             at(b, nx, ny, dx, 0) > 0 ) return 1;
+    }
+
+    auto next = at(b, nx, ny, dx, dy);
+    return next > 0 ? next + 1 : next - 1;
+}
+
+void cJumpTable::build(const cBoard& b, bool cornerCutting)
+{
+    if ( b.width() > 32767 || b.height() > 32767 )
+        throw std::runtime_error("Board too big for a jump table.");
+
+    mCornerCutting = cornerCutting;
+    mDist.assign(b.size() * 8, 0);
+    mTable = mDist.data();
+
+    long int w = b.width(), h = b.height();
+
+    // Straight lines first, since the diagonals depend on them. Every row
+    // (and column) is independent of the others; each is filled in from
+    // its far end, so that the next entry is always ready.
+    parallelFor(h, [&](size_t y)
+    {
+        for ( auto x = w - 1; x >= 0; --x ) at(b, x, y, 1, 0) = compute(b, x, y, 1, 0);
+        for ( auto x = 0l; x < w; ++x ) at(b, x, y, -1, 0) = compute(b, x, y, -1, 0);
+    });
+    parallelFor(w, [&](size_t x)
+    {
+        for ( auto y = h - 1; y >= 0; --y ) at(b, x, y, 0, 1) = compute(b, x, y, 0, 1);
+        for ( auto y = 0l; y < h; ++y ) at(b, x, y, 0, -1) = compute(b, x, y, 0, -1);
+    });
+
+    // Diagonals are independent of each other too. Each one starts on the
+    // edge of the board it's heading for: w + h - 1 of them per direction.
+    for ( auto& d : diagonals )
+    {
+        auto dx = d[0], dy = d[1];
+        long int xEdge = dx > 0 ? w - 1 : 0;
+        long int yEdge = dy > 0 ? h - 1 : 0;
+
+        parallelFor(w + h - 1, [&](size_t i)
+        {
+            long int x, y;
+            if ( i < static_cast<size_t>(w) )
+            {
+                x = i;
+                y = yEdge;
+            }
+            else
+            {
+                x = xEdge;
+                y = i - w;
+                if ( yEdge == 0 ) ++y;  // (xEdge, yEdge) was done above
+            }
+            for ( ; b.valid(x, y); x -= dx, y -= dy )
+                at(b, x, y, dx, dy) = compute(b, x, y, dx, dy);
+        });
+    }
+
+    mBuilt = true;
+}
+
+void cJumpTable::walkBack(const cBoard& b, long int x, long int y, int dx, int dy,
+                          std::vector<cNodeID>* flipped)
+{
+    for ( ; b.valid(x, y); x -= dx, y -= dy )
+    {
+        auto value = compute(b, x, y, dx, dy);
+        auto& entry = at(b, x, y, dx, dy);
+        if ( value == entry ) return;
+        if ( flipped && (value > 0) != (entry > 0) ) flipped->push_back(cNodeID(x, y));
+        entry = value;
+    }
+}
+
+void cJumpTable::update(const cBoard& b, const cNodeID& c1, const cNodeID& c2)
+{
+    if ( !mBuilt ) return;
+
+    if ( mTable != mDist.data() )
+    {
+        mDist.assign(mTable, mTable + b.size() * 8);
+        mTable = mDist.data();
+    }
+
+    // Whether a tile is blocked, has forced neighbours or is a gap we
+    // can't squeeze through depends on the tiles right next to it, so
+    // everything within 1 of the edited rectangle may have changed...
+    long int left = std::max(0, std::min(c1.x, c2.x) - 1);
+    long int right = std::min<long int>(b.width() - 1, std::max(c1.x, c2.x) + 1);
+    long int top = std::max(0, std::min(c1.y, c2.y) - 1);
+    long int bottom = std::min<long int>(b.height() - 1, std::max(c1.y, c2.y) + 1);
+
+    // ... and with it, the entry of every tile that jumps onto one of
+    // these. Walk back from all of them, starting with the ones furthest
+    // along the direction, so that most lines only need a single pass.
+    auto walkArea = [&](int dx, int dy, std::vector<cNodeID>* flipped)
+    {
+        for ( auto i = 0l; i <= bottom - top; ++i )
+            for ( auto j = 0l; j <= right - left; ++j )
+            {
+                auto x = dx > 0 ? right - j : left + j;
+                auto y = dy > 0 ? bottom - i : top + i;
+                walkBack(b, x - dx, y - dy, dx, dy, flipped);
+            }
+    };
+
+    // A straight entry that went from "jump point" to "wall" or back
+    // also changes the diagonals running through its tile.
+    std::vector<cNodeID> flipped[4];
+    for ( auto s = 0; s < 4; ++s )
+        walkArea(straights[s][0], straights[s][1], &flipped[s]);
+
+    for ( auto& d : diagonals )
+    {
+        auto dx = d[0], dy = d[1];
+        walkArea(dx, dy, nullptr);
+
+        for ( auto s = 0; s < 4; ++s )
+            if ( (straights[s][0] == dx && straights[s][1] == 0) ||
+                 (straights[s][0] == 0 && straights[s][1] == dy) )
+                for ( auto& n : flipped[s] )
+                    walkBack(b, n.x - dx, n.y - dy, dx, dy, nullptr);
+    }
+}
+
+cNodeID cJumpTable::jump(const cBoard& b,
+                         const cNodeID& current,
+                         int dx,
+                         int dy,
+                         const cNodeID& goal) const
+{
+    int     e = at(b, current.x, current.y, dx, dy);
+    cNodeID n { current };
+    n.valid = false;
+
+    if ( dx == 0 || dy == 0 )
+    {
+        // The goal is returned if it's on our line, and
+        // we'd get to it before the jump point or the wall.
+        auto g = 0;
+        if ( dy == 0 && goal.y == current.y ) g = (goal.x - current.x) * dx;
+        if ( dx == 0 && goal.x == current.x ) g = (goal.y - current.y) * dy;
+        if ( g > 0 && g <= std::abs(e) ) return goal;
+
+        if ( e > 0 ) return cNodeID(current.x + e * dx, current.y + e * dy);
+        return n;
+    }
+
+    // Moving diagonally, the goal matters if it's in the quadrant ahead of
+    // us: at step t we're level with it, and the straight scan line sent
+    // out from there finds it - unless it runs into a wall first.
+    auto tx = (goal.x - current.x) * dx;
+    auto ty = (goal.y - current.y) * dy;
+    auto t = std::min(tx, ty);
+    auto reach = e > 0 ? e - 1 : -e;    // steps we get through without stopping
+
+    if ( t >= 1 && t <= reach )
+    {
+        if ( tx == ty ) return goal;
+
+        cNodeID m { current.x + t * dx, current.y + t * dy };
+        if ( tx < ty && ty - tx <= -at(b, m.x, m.y, 0, dy) ) return m;
+        if ( tx > ty && tx - ty <= -at(b, m.x, m.y, dx, 0) ) return m;
+    }
+
+    if ( e > 0 ) return cNodeID(current.x + e * dx, current.y + e * dy);
+
+    // The step after the last one may still be the goal, if what stopped us
+    // there was a corner we can't squeeze past, rather than a wall.
+    if ( tx == ty && tx == reach + 1 && !b.blocked(goal.x, goal.y) ) return goal;
+
+    return n;
+}
@@ -0,0 +1,90 @@
+#ifndef __small_astartest__jumpTable__
+#define __small_astartest__jumpTable__
+
+#include <cstdint>
+#include <vector>
+#include "board.h"
+#include "nodeID.h"
+
+// Precomputed jump distances for JPS+.
+//
+// For every tile and each of the 8 directions, the table holds where
+// cPathFinder::jump() would stop if there were no goal on the board:
+//
+//  d > 0:  there's a jump point d steps away in that direction;
+//  d <= 0: there's no jump point, and -d steps can be taken before
+//          running into a wall (or, moving diagonally with corner
+//          cutting off, into a gap we may not squeeze through).
+//
+// jump() then only has to look at the goal, which is the one thing the
+// table can't know in advance, and gives the same answers as
+// cPathFinder::jump() without walking the board. Diagonal entries depend
+// on whether corner cutting is allowed, so a table is built for one
+// setting or the other.
+//
+// When the board is edited, update() recomputes only the entries that
+// actually change: starting from the edited rectangle, it walks back
+// along every affected row, column and diagonal, and stops as soon as
+// a recomputed entry comes out the same as before.
+//
+// A table restored from a snapshot (see snapshot.h) reads its entries
+// straight from the mapped file, until the first update() copies them.
+
+class cJumpTable {
+public:
+    cJumpTable() { }
+
+    // Full rebuild, spread over all cores. Throws std::runtime_error
+    // if the board is too big for 16 bit distances.
+    void        build(const cBoard&, bool cornerCutting);
+    void        clear();
+
+    bool        built() const { return mBuilt; }
+    bool        cornerCutting() const { return mCornerCutting; }
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive); bring the table up to date.
+    void        update(const cBoard&, const cNodeID&, const cNodeID&);
+
+    // Same contract as cPathFinder::jump().
+    cNodeID     jump(const cBoard&,
+                     const cNodeID& current,
+                     int dx,
+                     int dy,
+                     const cNodeID& goal) const;
+
+private:
+    static int  direction(int dx, int dy)
+                {
+                    auto d = (dy + 1) * 3 + (dx + 1);
+                    return d > 4 ? d - 1 : d;
+                }
+    int16_t&    at(const cBoard& b, long int x, long int y, int dx, int dy)
+                {
+                    return mDist[static_cast<size_t>(b.index(x, y)) * 8 + direction(dx, dy)];
+                }
+    int16_t     at(const cBoard& b, long int x, long int y, int dx, int dy) const
+                {
+                    return mTable[static_cast<size_t>(b.index(x, y)) * 8 + direction(dx, dy)];
+                }
+
+    // The value the entry of (x, y) should have, given the entries
+    // of the next tile in direction (dx, dy).
+    int16_t     compute(const cBoard&, long int x, long int y, int dx, int dy) const;
+
+    // Recomputes entries backwards along (dx, dy), starting at (x, y),
+    // until one doesn't change. Tiles whose entry changed between
+    // positive and non-positive are added to "flipped", if given.
+    void        walkBack(const cBoard&, long int x, long int y, int dx, int dy,
+                         std::vector<cNodeID>* flipped);
+
+private:
+    friend class cSnapshot;
+
+    std::vector<int16_t>    mDist;      // 8 entries per tile, by cBoard::index
+    const int16_t*          mTable { nullptr };     // mDist's, or mapped
+    bool                    mBuilt { false };
+    bool                    mCornerCutting { false };
+};
+
+#endif /* defined(__small_astartest__jumpTable__) */
@@ -0,0 +1,72 @@
+#ifndef __small_astartest__line__
+#define __small_astartest__line__
+
+#include <cstdlib>
+#include "nodeID.h"
+
+// The tiles of a straight line from a to b, one at a time: a first, b
+// last. This is the one line drawing of the pathfinder, so that smoothing,
+// line of sight checks and compact paths (see pathArena.h) all agree on
+// which tiles a line runs over.
+//
+// We distinguish between 2 basic cases: horizontal and vertical-like
+// lines. That's important because getting this wrong might result in a
+// wrong number of points drawn (e.g. a line from 9:10 to 11:20, only 3
+// points are drawn if we try to draw this as horizontal).
+
+class cLine {
+public:
+    cLine() { }
+    cLine(const cNodeID& a, const cNodeID& b):
+    mTile { a },
+    mEnd { b },
+    mStep { (b.x > a.x) - (b.x < a.x), (b.y > a.y) - (b.y < a.y) },
+    mAdx { std::abs(b.x - a.x) },
+    mAdy { std::abs(b.y - a.y) },
+    // tmp keeps track of when we need to step along the other axis too;
+    // for an evenly distributed line, it starts from half of the longer
+    // component.
+    mTmp { (mAdx > mAdy ? mAdx : mAdy) / 2 }
+    {
+    }
+
+    const cNodeID&  tile() const { return mTile; }
+    bool            done() const { return mTile == mEnd; }
+
+    // On to the next tile; the line must not be done().
+    void            next()
+                    {
+                        if ( mAdx > mAdy )      // horizontal line
+                        {
+                            mTile.x += mStep.x;
+                            mTmp += mAdy;
+                            if ( mTmp >= mAdx )
+                            {
+                                mTmp -= mAdx;
+                                mTile.y += mStep.y;
+                            }
+                        }
+                        else                    // vertical line
+                        {
+                            mTile.y += mStep.y;
+                            mTmp += mAdx;
+
+                            // (A single diagonal step would never get here otherwise.)
+                            if ( mTmp > mAdy || mAdx == mAdy )
+                            {
+                                mTmp -= mAdy;
+                                mTile.x += mStep.x;
+                            }
+                        }
+                    }
+
+private:
+    cNodeID         mTile;
+    cNodeID         mEnd;
+    cNodeID         mStep;
+    int             mAdx { 0 };
+    int             mAdy { 0 };
+    int             mTmp { 0 };
+};
+
+#endif /* defined(__small_astartest__line__) */
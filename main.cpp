@@ -2,6 +2,7 @@
 #include <SFML/Window.hpp>
 #include <iostream>
 #include "pathfinder.h"
+#include "boardView.h"
 #include "ResourcePath.hpp"
 
 const unsigned int VSX { 500 };         // view size x
@@ -13,6 +14,8 @@ const unsigned int WSY { 600 };         // window size y
 const unsigned int BSX { 250 };          // board size x
 const unsigned int BSY { 250 };          // you guessed it
 
+const double       SLICE { 4000 };      // microseconds of searching per frame
+
 bool            gMouseOnScreen { true };
 bool            gMouseLeftPressed { false };
 bool            gMouseRightPressed { false };
@@ -25,6 +28,10 @@ sf::Text        tMethod;
 
 bool            gJPS { false };
 
+// The search for the path to the mouse, a slice of it every frame, so
+// that a long one doesn't hold up drawing.
+cSearchHandle   gSearch;
+
 sf::Clock       gPathCalcClock;
 sf::Time        gPathCalcTime;
 
@@ -42,6 +49,7 @@ sf::Text        tSmooth;
 //    This is where the magic happens:          //
                                                 //
 cPathFinder     p { BSX, BSY };                 //
+cBoardView      view { p };                     //
                                                 //
 //////////////////////////////////////////////////
 
@@ -88,7 +96,7 @@ void processEvents(sf::RenderWindow& window, sf::View& v)
                 if ( gMouseStart.x < 500 && gMouseStart.y < 500)
                 {
                     gMouseLeftPressed = true;
-                    p.startMarking(gMouseStart);
+                    view.startMarking(gMouseStart);
                 }
                 else
                 {
@@ -123,17 +131,25 @@ void processEvents(sf::RenderWindow& window, sf::View& v)
                     if ( gMouseStart.x > 520 && gMouseStart.x < 700 &&
                          gMouseStart.y > 140 && gMouseStart.y < 160)
                     {
-                        if ( gJPS == false )
+                        // A* -> JPS -> shortest path tree -> A*
+                        gSearch.cancel();
+                        if ( gJPS == false && p.mPathTree == false )
                         {
                             gJPS = true;
                             tMethod.setString("Method: jump point search");
                             p.mJPS = true;
                         }
-                        else
+                        else if ( gJPS )
                         {
                             gJPS = false;
-                            tMethod.setString("Method: standard A*");
+                            tMethod.setString("Method: shortest path tree");
                             p.mJPS = false;
+                            p.mPathTree = true;
+                        }
+                        else
+                        {
+                            tMethod.setString("Method: standard A*");
+                            p.mPathTree = false;
                         }
                     }
                 }
@@ -149,7 +165,7 @@ void processEvents(sf::RenderWindow& window, sf::View& v)
             {
                 gMouseLeftPressed = false;
                 gMouseEnd = sf::Mouse::getPosition(window);
-                p.toggleMarkedOnes();
+                view.toggleMarkedOnes();
             }
             if ( event.mouseButton.button == sf::Mouse::Right && gMouseRightPressed )
             {
@@ -161,16 +177,29 @@ void processEvents(sf::RenderWindow& window, sf::View& v)
     
     if ( sf::Mouse::isButtonPressed(sf::Mouse::Left) && gMouseOnScreen
         && gMouseLeftPressed)
-        p.keepMarking(sf::Mouse::getPosition(window));
+        view.keepMarking(sf::Mouse::getPosition(window));
     
     gPathCalcClock.restart();
     bool tmp { false };
     if ( gMouseOnScreen && !gMouseLeftPressed && !gMouseRightPressed )
     {
-        tmp = p.walk(sf::Vector2i(40,40), sf::Mouse::getPosition(window), gCornerCutting, gSmoothing);
+        // The path tree answers at once; it isn't searched.
+        if ( p.mPathTree )
+            tmp = view.walk(sf::Vector2i(40,40), sf::Mouse::getPosition(window), gCornerCutting, gSmoothing);
+        else
+            tmp = view.walk(gSearch, sf::Vector2i(40,40), sf::Mouse::getPosition(window),
+                            gCornerCutting, gSmoothing, SLICE);
     }
     gPathCalcTime = gPathCalcClock.restart();
     
+    // A sliced search is timed over all its frames, once it's found.
+    if ( tmp && !p.mPathTree )
+    {
+        auto& stats = gSearch.stats();
+        gPathCalcTime = sf::microseconds(static_cast<sf::Int64>(stats.searchMicros + stats.reconstructMicros +
+                                                                stats.smoothMicros));
+    }
+
     if (tmp)    // only measure succesful pathing
     {
         if ( gPathTimeAvg == 0 )
@@ -208,6 +237,15 @@ int main()
     
     sf::Mouse::setPosition(sf::Vector2i(100, 100), window);
     
+    // The same path gets asked for every frame while the mouse rests.
+    // The path tree mode goes through the cache; the others keep the path
+    // they found in gSearch.
+    p.mCachePaths = true;
+    
+    // A goal that's walled off would otherwise cost a search of the whole
+    // reachable board, every frame.
+    p.mRejectUnreachable = true;
+    
     gFont.loadFromFile(resourcePath() + "sansation.ttf");
     tFPS.setFont(gFont);
     tFPS.setCharacterSize(16);
@@ -241,7 +279,7 @@ int main()
     // then forget about it, but later an eye should be kept on
     // updating it as necessary.
     
-    p.setView(mainView);
+    view.setView(mainView);
     fpsclock.restart();
     
     while ( window.isOpen())
@@ -265,7 +303,7 @@ int main()
         window.clear();
         window.setView(mainView);
         
-        p.render(window);
+        view.render(window);
         ++currentFPS;
         timeSinceLastRender += fpsclock.restart();
         if ( timeSinceLastRender >= sf::seconds(1.0) )
@@ -274,7 +312,10 @@ int main()
             currentFPS = 0;
             tFPS.setString("FPS: " + i2s(pastFPS));
             timeSinceLastRender -= sf::seconds(1.0);
-            tPath.setString("Avg. pathing time (microsec.): " + i2s(gPathTimeAvg));
+            std::string cache { };
+            if ( p.mPathTree )
+                cache = "\nPath cache hits: " + i2s(static_cast<int>(p.pathCache().hitRate() * 100)) + "%";
+            tPath.setString("Avg. pathing time (microsec.): " + i2s(gPathTimeAvg) + cache);
         }
         
         window.setView(guiView);
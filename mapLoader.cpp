@@ -0,0 +1,202 @@
+#include "mapLoader.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+std::unique_ptr<cPathFinder> loadMap(std::istream& in)
+{
+    std::vector<std::string>    rows;
+    std::string                 line;
+
+    while ( std::getline(in, line) )
+    {
+        if ( !line.empty() && line.back() == '\r' ) line.pop_back();
+        if ( line.empty() ) continue;
+        if ( !rows.empty() && line.size() != rows.front().size() )
+            throw std::runtime_error("Map rows are not of equal length.");
+        rows.push_back(line);
+    }
+
+    if ( rows.empty() ) throw std::runtime_error("Empty map.");
+
+    std::unique_ptr<cPathFinder> p { new cPathFinder(rows.front().size(), rows.size()) };
+
+    for ( size_t y = 0; y < rows.size(); ++y )
+        for ( size_t x = 0; x < rows[y].size(); ++x )
+            if ( rows[y][x] != '.' ) p->setBlocked(x, y, true);
+
+    return p;
+}
+
+std::vector<cQuery> loadQueries(std::istream& in)
+{
+    std::vector<cQuery>     ret;
+    std::string             line;
+
+    while ( std::getline(in, line) )
+    {
+        auto comment = line.find('#');
+        if ( comment != std::string::npos ) line.erase(comment);
+
+        std::istringstream  ss { line };
+        cQuery              q;
+        if ( !(ss >> q.start.x) ) continue;     // blank line
+        if ( !(ss >> q.start.y >> q.goal.x >> q.goal.y) )
+            throw std::runtime_error("Malformed query: " + line);
+        ret.push_back(q);
+    }
+
+    return ret;
+}
+
+namespace {
+
+// Header: "type octile", "height H", "width W", in any order, up to "map".
+void readHeader(std::istream& in, long int& width, long int& height)
+{
+    std::string word;
+    width = height = -1;
+
+    while ( in >> word && word != "map" )
+    {
+        if ( word == "height" ) in >> height;
+        else if ( word == "width" ) in >> width;
+        else if ( word == "type" ) in >> word;
+        else throw std::runtime_error("Unknown map header field: " + word);
+    }
+
+    if ( word != "map" || width <= 0 || height <= 0 )
+        throw std::runtime_error("Malformed map header.");
+}
+
+bool walkable(char c)
+{
+    return c == '.' || c == 'G' || c == 'S';
+}
+
+// The rows of a .map file, read a chunk at a time; see openMovingAIMap().
+class cMapFile {
+public:
+    explicit cMapFile(const std::string& file):
+    mFile { file },
+    mIn { file, std::ios::binary }
+    {
+        if ( !mIn ) throw std::runtime_error("Cannot open " + file);
+        readHeader(mIn, mWidth, mHeight);
+
+        std::string row;
+        std::getline(mIn, row);     // the rest of the "map" line
+        mFirst = mIn.tellg();
+        if ( !std::getline(mIn, row) ) throw std::runtime_error("Map row 0 is missing.");
+
+        bool crlf = !row.empty() && row.back() == '\r';
+        if ( crlf ) row.pop_back();
+        if ( row.size() != static_cast<size_t>(mWidth) ) throw std::runtime_error("Map row 0 is of the wrong length.");
+        mStride = mWidth + (crlf ? 2 : 1);
+    }
+
+    unsigned int width() const { return static_cast<unsigned int>(mWidth); }
+    unsigned int height() const { return static_cast<unsigned int>(mHeight); }
+
+    void operator()(unsigned int cx, unsigned int cy, uint64_t* rows)
+    {
+        long int x0 = cx * cBoard::chunkSize;
+        long int tiles = std::min<long int>(cBoard::chunkSize, mWidth - x0);
+        bool last = x0 + tiles == mWidth;
+
+        // The chunk's part of each row, and the line break after the
+        // last part (the last row may go without), as a check that the
+        // rows are where we think.
+        char buffer[cBoard::chunkSize + 1];
+        for ( long int j = 0; j < cBoard::chunkSize; ++j )
+        {
+            long int y = cy * cBoard::chunkSize + j;
+            if ( y >= mHeight ) break;
+
+            bool lineBreak = last && y + 1 < mHeight;
+            mIn.clear();
+            mIn.seekg(mFirst + static_cast<std::streamoff>(y) * mStride + x0);
+            if ( !mIn.read(buffer, tiles + lineBreak) ||
+                 (lineBreak && buffer[tiles] != '\n' && buffer[tiles] != '\r') )
+                throw std::runtime_error("Map row " + std::to_string(y) + " of " + mFile +
+                                         " is missing or of the wrong length.");
+
+            for ( long int i = 0; i < tiles; ++i )
+                if ( walkable(buffer[i]) ) rows[j] |= uint64_t(1) << i;
+        }
+    }
+
+private:
+    std::string     mFile;
+    std::ifstream   mIn;
+    long int        mWidth;
+    long int        mHeight;
+    std::streamoff  mFirst;     // where row 0 starts
+    std::streamoff  mStride;    // from one row to the next
+};
+
+}
+
+std::unique_ptr<cPathFinder> loadMovingAIMap(std::istream& in)
+{
+    long int        width, height;
+    readHeader(in, width, height);
+
+    std::unique_ptr<cPathFinder> p { new cPathFinder(width, height) };
+
+    std::string row;
+    for ( auto y = 0; y < height; ++y )
+    {
+        if ( !(in >> row) || row.size() != static_cast<size_t>(width) )
+            throw std::runtime_error("Map row " + std::to_string(y) + " is missing or of the wrong length.");
+
+        for ( auto x = 0; x < width; ++x )
+            if ( !walkable(row[x]) ) p->setBlocked(x, y, true);
+    }
+
+    return p;
+}
+
+std::unique_ptr<cPathFinder> openMovingAIMap(const std::string& file, size_t budget)
+{
+    auto map = std::make_shared<cMapFile>(file);
+    return std::unique_ptr<cPathFinder> { new cPathFinder(map->width(), map->height(),
+                                                          [map](unsigned int cx, unsigned int cy, uint64_t* rows)
+                                                          {
+                                                              (*map)(cx, cy, rows);
+                                                          },
+                                                          budget) };
+}
+
+std::unique_ptr<cPathFinder> openSnapshot(const std::string& file)
+{
+    return std::unique_ptr<cPathFinder> { new cPathFinder(std::make_shared<const cSnapshot>(file)) };
+}
+
+std::vector<cScenario> loadScenarios(std::istream& in)
+{
+    std::vector<cScenario>  ret;
+    std::string             line;
+
+    while ( std::getline(in, line) )
+    {
+        if ( !line.empty() && line.back() == '\r' ) line.pop_back();
+
+        std::istringstream  ss { line };
+        std::string         first;
+        if ( !(ss >> first) || first == "version" ) continue;   // header, blank line
+
+        std::istringstream  fields { line };
+        cScenario           s;
+        if ( !(fields >> s.bucket >> s.map >> s.width >> s.height >>
+               s.start.x >> s.start.y >> s.goal.x >> s.goal.y >> s.optimal) )
+            throw std::runtime_error("Malformed scenario: " + line);
+        ret.push_back(s);
+    }
+
+    return ret;
+}
@@ -0,0 +1,57 @@
+#ifndef __small_astartest__mapLoader__
+#define __small_astartest__mapLoader__
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "nodeID.h"
+#include "pathfinder.h"
+
+// Plain text input for headless use of the pathfinder.
+//
+// A map is a block of equally long rows, one character per tile:
+// '.' is walkable, anything else is blocked. Blank lines are skipped.
+//
+// A query file lists one query per line as four integers,
+// "startx starty goalx goaly", in tile coordinates. Everything after
+// a '#' is a comment.
+//
+// The Moving AI benchmark formats (movingai.com/benchmarks) are read too.
+// A .map file is a short header ("type octile", "height H", "width W",
+// "map") followed by the rows; '.', 'G' and 'S' are walkable, anything
+// else ('@', 'O', 'T', 'W') is blocked. A .scen file starts with
+// "version 1", then has one scenario per line:
+// "bucket map width height startx starty goalx goaly optimal_length".
+// Optimal lengths count a diagonal step as sqrt(2), with no corner cutting.
+//
+// openMovingAIMap() makes a paged board of a .map file (see cBoard): only
+// the header is read up front, and then the rows of a chunk when a search
+// first gets there, so the map never has to be in memory all at once.
+// For that, every row must end the same way ("\n" or "\r\n"), so that
+// each tile is at a known offset in the file. The file stays open for as
+// long as the pathfinder lives.
+//
+// openSnapshot() maps a binary snapshot saved by
+// cPathFinder::saveSnapshot() (see snapshot.h); nothing in it is parsed.
+
+struct cScenario {
+    int             bucket;
+    std::string     map;
+    unsigned int    width;
+    unsigned int    height;
+    cNodeID         start;
+    cNodeID         goal;
+    double          optimal;
+};
+
+// All of these throw std::runtime_error on malformed input.
+std::unique_ptr<cPathFinder>    loadMap(std::istream&);
+std::vector<cQuery>             loadQueries(std::istream&);
+
+std::unique_ptr<cPathFinder>    loadMovingAIMap(std::istream&);
+std::unique_ptr<cPathFinder>    openMovingAIMap(const std::string& file, size_t budget);
+std::unique_ptr<cPathFinder>    openSnapshot(const std::string& file);
+std::vector<cScenario>          loadScenarios(std::istream&);
+
+#endif /* defined(__small_astartest__mapLoader__) */
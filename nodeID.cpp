@@ -6,17 +6,14 @@ x { 0 }, y { 0 }, valid { true } { }
 cNodeID::cNodeID(int a, int b):
 x { a }, y { b }, valid { true } { }
 
-cNodeID::cNodeID(sf::Vector2i v):
-x { v.x }, y { v.y }, valid { true } { }
-
 bool operator<(const cNodeID& a, const cNodeID& b)
 {
-    return a.x < b.x;
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
 }
 
 bool operator>(const cNodeID& a, const cNodeID& b)
 {
-    return a.x > b.x;
+    return b < a;
 }
 
 bool operator==(const cNodeID& a, const cNodeID& b)
@@ -1,12 +1,9 @@
 #ifndef __small_astartest__nodeID__
 #define __small_astartest__nodeID__
 
-#include <SFML/Graphics.hpp>
-
 struct cNodeID {
     cNodeID();
     cNodeID(int, int);
-    cNodeID(sf::Vector2i);
     
     cNodeID& operator=(const cNodeID& rhs)
     {
@@ -0,0 +1,168 @@
+#include "pathArena.h"
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+bool fits(const cNodeID& d)
+{
+    return d.x >= -32768 && d.x <= 32767 && d.y >= -32768 && d.y <= 32767;
+}
+
+uint32_t pack(const cNodeID& d)
+{
+    return uint32_t(uint16_t(int16_t(d.x))) | uint32_t(uint16_t(int16_t(d.y))) << 16;
+}
+
+cNodeID unpack(uint32_t w)
+{
+    return cNodeID { int16_t(w & 0xffff), int16_t(w >> 16) };
+}
+
+// Straight or diagonal: a run of single steps in one direction.
+bool octile(const cNodeID& d)
+{
+    return d.x == 0 || d.y == 0 || std::abs(d.x) == std::abs(d.y);
+}
+
+cNodeID direction(const cNodeID& d)
+{
+    return cNodeID { (d.x > 0) - (d.x < 0), (d.y > 0) - (d.y < 0) };
+}
+
+}
+
+const unsigned int cPathArena::npos;
+
+cPathArena::cIterator::cIterator(const uint32_t* words, const uint32_t* end, bool cells):
+mWord { words + 1 },
+mEnd { end },
+mLine { unpack(*words), unpack(*words) },
+mCells { cells }
+{
+}
+
+cPathArena::cIterator& cPathArena::cIterator::operator++()
+{
+    if ( mCells && !mLine.done() )
+    {
+        mLine.next();
+        return *this;
+    }
+
+    if ( mWord == mEnd )
+    {
+        mWord = nullptr;
+        return *this;
+    }
+
+    // On to the next waypoint; the line to it starts where the last
+    // one ended, and that tile has been seen already.
+    auto from = mLine.tile();
+    auto to = from + unpack(*mWord++);
+    mLine = mCells ? cLine { from, to } : cLine { to, to };
+    if ( mCells ) mLine.next();
+    return *this;
+}
+
+unsigned int cPathArena::add(const std::vector<cNodeID>& path)
+{
+    if ( path.empty() ) return npos;
+
+    auto offset = mWords.size();
+    if ( !fits(path.front()) ) throw std::runtime_error("Path doesn't fit the arena's 16 bit moves.");
+    mWords.push_back(pack(path.front()));
+
+    // The last move, which the next one may just lengthen.
+    cNodeID last { 0, 0 };
+    for ( size_t i = 1; i < path.size(); ++i )
+    {
+        auto d = path[i] - path[i - 1];
+        if ( d.x == 0 && d.y == 0 ) continue;
+
+        auto longer = last + d;
+        if ( mWords.size() > offset + 1 && octile(last) && octile(d) &&
+             direction(last) == direction(d) && fits(longer) )
+        {
+            last = longer;
+            mWords.back() = pack(last);
+            continue;
+        }
+
+        if ( !fits(d) )
+        {
+            mWords.resize(offset);
+            throw std::runtime_error("Path doesn't fit the arena's 16 bit moves.");
+        }
+        last = d;
+        mWords.push_back(pack(d));
+    }
+
+    cEntry entry { static_cast<uint32_t>(offset), static_cast<uint32_t>(mWords.size() - offset) };
+    if ( mFree.empty() )
+    {
+        mPaths.push_back(entry);
+        return static_cast<unsigned int>(mPaths.size() - 1);
+    }
+
+    auto id = mFree.back();
+    mFree.pop_back();
+    mPaths[id] = entry;
+    return id;
+}
+
+void cPathArena::release(unsigned int id)
+{
+    if ( id >= mPaths.size() || mPaths[id].words == 0 ) return;
+
+    mDead += mPaths[id].words;
+    mPaths[id].words = 0;
+    mFree.push_back(id);
+
+    if ( mDead > mWords.size() - mDead ) compact();
+}
+
+void cPathArena::clear()
+{
+    mWords.clear();
+    mPaths.clear();
+    mFree.clear();
+    mDead = 0;
+}
+
+void cPathArena::compact()
+{
+    std::vector<uint32_t> words;
+    words.reserve(mWords.size() - mDead);
+
+    for ( auto& e : mPaths )
+    {
+        if ( e.words == 0 ) continue;
+
+        auto offset = words.size();
+        words.insert(words.end(), mWords.begin() + e.offset, mWords.begin() + e.offset + e.words);
+        e.offset = static_cast<uint32_t>(offset);
+    }
+
+    mWords.swap(words);
+    mDead = 0;
+}
+
+cPathArena::cRange cPathArena::cells(unsigned int id) const
+{
+    auto w = mWords.data() + mPaths[id].offset;
+    return cRange { cIterator { w, w + mPaths[id].words, true }, cIterator { } };
+}
+
+cPathArena::cRange cPathArena::waypoints(unsigned int id) const
+{
+    auto w = mWords.data() + mPaths[id].offset;
+    return cRange { cIterator { w, w + mPaths[id].words, false }, cIterator { } };
+}
+
+size_t cPathArena::memoryUsage() const
+{
+    return mWords.capacity() * sizeof(uint32_t) +
+           mPaths.capacity() * sizeof(cEntry) +
+           mFree.capacity() * sizeof(unsigned int);
+}
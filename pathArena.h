@@ -0,0 +1,104 @@
+#ifndef __small_astartest__pathArena__
+#define __small_astartest__pathArena__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "line.h"
+#include "nodeID.h"
+
+// Compact storage for many paths at once, for agents that hold on to
+// their paths rather than just walk them.
+//
+// A path is kept as its start and its waypoints, each as a move from the
+// one before: a 16 bit dx and dy packed in one 32 bit word. Between two
+// waypoints the path runs along a straight line (see cLine). A tile by
+// tile path only needs a waypoint where it turns, so it becomes a run
+// length code: a move of (5, -5) is five steps up and right. Any-angle
+// paths (Theta*, smoothing) just keep their waypoints. So a path costs 4
+// bytes a turn, plus 12 bytes for its start and its entry, where a
+// std::vector<cNodeID> spends 12 bytes a tile.
+//
+// All paths share one buffer. Each gets an id, which stays the same
+// until the path is released. Released paths leave holes, and once the
+// holes outweigh the paths, the rest are moved together.
+//
+// Paths are read back lazily: cells() walks the tiles, drawing the lines
+// between waypoints as it goes, and waypoints() just the turning points.
+// add(), release() and clear() invalidate both.
+//
+// Moves must fit in 16 bits, so boards can be up to 32767 tiles a side.
+// Not thread safe.
+
+class cPathArena {
+public:
+    static const unsigned int npos = ~0u;
+
+    // Walks a stored path, either tile by tile or waypoint by waypoint.
+    class cIterator {
+    public:
+        cIterator() { }
+        cIterator(const uint32_t* words, const uint32_t* end, bool cells);
+
+        const cNodeID&  operator*() const { return mLine.tile(); }
+        const cNodeID*  operator->() const { return &mLine.tile(); }
+        cIterator&      operator++();
+
+        bool            operator==(const cIterator& o) const
+                        {
+                            return mWord == o.mWord && (mWord == nullptr || mLine.tile() == o.mLine.tile());
+                        }
+        bool            operator!=(const cIterator& o) const { return !(*this == o); }
+
+    private:
+        const uint32_t* mWord { nullptr };  // the next move; nullptr past the end
+        const uint32_t* mEnd { nullptr };
+        cLine           mLine;
+        bool            mCells { true };
+    };
+
+    struct cRange {
+        cIterator       first;
+        cIterator       last;
+
+        cIterator       begin() const { return first; }
+        cIterator       end() const { return last; }
+    };
+
+    cPathArena() { }
+
+    // Stores a path given by any of its points, as long as a straight line
+    // joins each to the next: the tiles of a path, or its jump points, or
+    // its waypoints. Returns its id, or npos for an empty path. Throws
+    // std::runtime_error if a move doesn't fit in 16 bits.
+    unsigned int    add(const std::vector<cNodeID>&);
+    void            release(unsigned int id);
+    void            clear();
+
+    cRange          cells(unsigned int id) const;
+    cRange          waypoints(unsigned int id) const;
+
+    // Waypoints, start and goal included.
+    size_t          waypointCount(unsigned int id) const { return mPaths[id].words; }
+
+    size_t          size() const { return mPaths.size() - mFree.size(); }
+
+    // Bytes held, by the moves and the path entries.
+    size_t          memoryUsage() const;
+
+private:
+    struct cEntry {
+        uint32_t    offset;     // of the start, in mWords
+        uint32_t    words;      // 0: released
+    };
+
+    void            compact();
+
+private:
+    std::vector<uint32_t>       mWords;     // per path: its start, then its moves
+    std::vector<cEntry>         mPaths;     // by id
+    std::vector<unsigned int>   mFree;      // released ids
+    size_t                      mDead { 0 };    // words of released paths
+};
+
+#endif /* defined(__small_astartest__pathArena__) */
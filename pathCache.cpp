@@ -0,0 +1,118 @@
+#include "pathCache.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// Edits remembered; entries last checked before the oldest of these
+// are simply dropped.
+const size_t maxEdits { 1024 };
+
+}
+
+cPathCache::cPathCache(size_t capacity):
+mCapacity { std::max<size_t>(1, capacity) }
+{
+}
+
+void cPathCache::erase(entries::iterator it)
+{
+    mPathBytes -= it->path.capacity() * sizeof(cNodeID);
+    mIndex.erase(it->key);
+    mEntries.erase(it);
+}
+
+bool cPathCache::stale(const cEntry& e) const
+{
+    auto missed = mVersion - e.version;     // edits since it was checked
+    if ( missed == 0 ) return false;
+    if ( missed > mEdits.size() ) return true;
+
+    for ( auto i = mEdits.size() - missed; i < mEdits.size(); ++i )
+        if ( mEdits[i].box.intersects(e.box) ) return true;
+
+    return false;
+}
+
+const std::vector<cNodeID>* cPathCache::find(const cKey& key)
+{
+    auto found = mIndex.find(key);
+    if ( found == mIndex.end() )
+    {
+        ++mMisses;
+        return nullptr;
+    }
+
+    auto it = found->second;
+    if ( stale(*it) )
+    {
+        erase(it);
+        ++mInvalidations;
+        ++mMisses;
+        return nullptr;
+    }
+
+    it->version = mVersion;
+    mEntries.splice(mEntries.begin(), mEntries, it);
+    ++mHits;
+    return &it->path;
+}
+
+void cPathCache::insert(const cKey& key, const std::vector<cNodeID>& path)
+{
+    auto found = mIndex.find(key);
+    if ( found != mIndex.end() ) erase(found->second);
+
+    while ( mEntries.size() >= mCapacity )
+        erase(std::prev(mEntries.end()));
+
+    cBox box { INT_MIN, INT_MIN, INT_MAX, INT_MAX };
+    if ( !path.empty() )
+    {
+        box = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+        for ( auto& n : path )
+        {
+            box.left = std::min(box.left, n.x - 1);
+            box.top = std::min(box.top, n.y - 1);
+            box.right = std::max(box.right, n.x + 1);
+            box.bottom = std::max(box.bottom, n.y + 1);
+        }
+    }
+
+    mEntries.push_front(cEntry { key, path, box, mVersion });
+    mIndex[key] = mEntries.begin();
+    mPathBytes += mEntries.front().path.capacity() * sizeof(cNodeID);
+}
+
+void cPathCache::edited(const cNodeID& a, const cNodeID& b)
+{
+    mEdits.push_back(cEdit { ++mVersion, cBox { std::min(a.x, b.x), std::min(a.y, b.y),
+                                                std::max(a.x, b.x), std::max(a.y, b.y) } });
+    if ( mEdits.size() > maxEdits ) mEdits.pop_front();
+}
+
+void cPathCache::clear()
+{
+    mEntries.clear();
+    mIndex.clear();
+    mPathBytes = 0;
+}
+
+void cPathCache::setCapacity(size_t capacity)
+{
+    mCapacity = std::max<size_t>(1, capacity);
+    while ( mEntries.size() > mCapacity )
+        erase(std::prev(mEntries.end()));
+}
+
+size_t cPathCache::memoryUsage() const
+{
+    // A list node is an entry plus two pointers; a hash node is a key, an
+    // iterator, a cached hash and a next pointer, plus a bucket pointer.
+    return sizeof(*this) +
+           mEntries.size() * (sizeof(cEntry) + 2 * sizeof(void*)) +
+           mIndex.size() * (sizeof(cKey) + sizeof(entries::iterator) + 2 * sizeof(void*)) +
+           mIndex.bucket_count() * sizeof(void*) +
+           mEdits.size() * sizeof(cEdit) +
+           mPathBytes;
+}
@@ -0,0 +1,135 @@
+#ifndef __small_astartest__pathCache__
+#define __small_astartest__pathCache__
+
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "nodeID.h"
+#include "enums.h"
+
+// Cache of finished paths, for agents that keep asking the same question.
+//
+// Entries are keyed by everything that decides what findPath() returns:
+// start, goal, corner cutting, smoothing, and the engine, heuristic,
+// direction and open list that found the path (the heap and the bucket
+// queue break ties differently, so they may find different paths of the
+// same length). Each entry remembers the bounding box of its path, grown
+// by one tile. That covers every tile the path runs over, plus the tiles that
+// decide whether it may cut a corner. A path with no tiles (no route)
+// gets a box covering the whole board.
+//
+// Invalidation is versioned and lazy. An edit just bumps the version
+// and logs its rectangle. Looking an entry up replays only the edits
+// made since it was last seen. The entry is dropped if any of them hits
+// its box; otherwise it's stamped with the current version. So edits
+// cost O(1), however many entries there are. If an entry is older than
+// the oldest edit still in the log, it's dropped as well.
+//
+// An edit outside the box can't make a cached path invalid. It can open
+// a shorter route, though, and the cache doesn't notice that.
+//
+// When full, the least recently used entry makes room.
+
+class cPathCache {
+public:
+    struct cKey {
+        cNodeID     start;
+        cNodeID     goal;
+        bool        cornerCutting;
+        bool        smooth;
+        cEngine     engine;
+        cHeuristic  heuristic;
+        bool        bidirectional;
+        cOpenList   openList;
+
+        bool operator==(const cKey& o) const
+        {
+            return start == o.start && goal == o.goal && cornerCutting == o.cornerCutting &&
+                   smooth == o.smooth && engine == o.engine && heuristic == o.heuristic &&
+                   bidirectional == o.bidirectional && openList == o.openList;
+        }
+    };
+
+    explicit cPathCache(size_t capacity = 4096);
+
+    // The cached path, or nullptr if there's none (or it's gone stale).
+    // Counts as a hit or a miss. The pointer is good until the next
+    // call that changes the cache.
+    const std::vector<cNodeID>*     find(const cKey&);
+    void                            insert(const cKey&, const std::vector<cNodeID>&);
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive).
+    void            edited(const cNodeID&, const cNodeID&);
+    void            clear();
+
+    size_t          capacity() const { return mCapacity; }
+    void            setCapacity(size_t);
+
+    size_t          size() const { return mEntries.size(); }
+    unsigned long   hits() const { return mHits; }
+    unsigned long   misses() const { return mMisses; }
+    unsigned long   invalidations() const { return mInvalidations; }
+    double          hitRate() const
+                    {
+                        return mHits + mMisses == 0 ? 0.0 : double(mHits) / (mHits + mMisses);
+                    }
+
+    // Bytes held by the entries, their paths and the edit log, with an
+    // estimate for the hash table's own bookkeeping.
+    size_t          memoryUsage() const;
+
+private:
+    struct cBox {
+        int         left, top, right, bottom;
+
+        bool        intersects(const cBox& o) const
+                    {
+                        return left <= o.right && o.left <= right &&
+                               top <= o.bottom && o.top <= bottom;
+                    }
+    };
+
+    struct cEntry {
+        cKey                    key;
+        std::vector<cNodeID>    path;
+        cBox                    box;
+        unsigned long           version;    // checked against edits up to here
+    };
+
+    struct cEdit {
+        unsigned long           version;
+        cBox                    box;
+    };
+
+    struct cHash {
+        size_t operator()(const cKey& k) const
+        {
+            size_t h = static_cast<size_t>(k.start.x) * 73856093u ^ static_cast<size_t>(k.start.y) * 19349663u ^
+                       static_cast<size_t>(k.goal.x) * 83492791u ^ static_cast<size_t>(k.goal.y) * 2654435761u;
+            return h ^ (static_cast<size_t>(k.openList) << 9 | size_t(k.bidirectional) << 8 |
+                        static_cast<size_t>(k.heuristic) << 6 | static_cast<size_t>(k.engine) << 2 |
+                        k.cornerCutting << 1 | k.smooth);
+        }
+    };
+
+    typedef std::list<cEntry>   entries;    // most recently used first
+
+    bool            stale(const cEntry&) const;
+    void            erase(entries::iterator);
+
+private:
+    entries                                                 mEntries;
+    std::unordered_map<cKey, entries::iterator, cHash>      mIndex;
+    std::deque<cEdit>                                       mEdits;     // oldest first
+    size_t                                                  mCapacity;
+    size_t                                                  mPathBytes { 0 };
+    unsigned long                                           mVersion { 0 };
+    unsigned long                                           mHits { 0 };
+    unsigned long                                           mMisses { 0 };
+    unsigned long                                           mInvalidations { 0 };
+};
+
+#endif /* defined(__small_astartest__pathCache__) */
@@ -0,0 +1,179 @@
+#include "pathTree.h"
+#include <algorithm>
+#include <cstdlib>
+#include "scoring.h"
+
+const unsigned int cPathTree::npos;
+
+void cPathTree::clear()
+{
+    mDist.clear();
+    mDist.shrink_to_fit();
+    mParent.clear();
+    mParent.shrink_to_fit();
+    mOpen.resize(0);
+    mBuilt = false;
+}
+
+bool cPathTree::step(const cBoard& b, unsigned int from, unsigned int to) const
+{
+    auto fx = from % b.width(), fy = from / b.width();
+    auto dx = long(to % b.width()) - fx, dy = long(to / b.width()) - fy;
+
+    if ( b.blocked(fx, fy) || b.blocked(fx + dx, fy + dy) ) return false;
+    if ( mCornerCutting || dx == 0 || dy == 0 ) return true;
+    return !b.blocked(fx + dx, fy) && !b.blocked(fx, fy + dy);
+}
+
+void cPathTree::settle(const cBoard& b)
+{
+    while ( !mOpen.empty() )
+    {
+        auto u = mOpen.pop_and_get();
+        long ux = u % b.width(), uy = u / b.width();
+        ++mSettled;
+
+        for ( auto dy = -1; dy < 2; ++dy )
+            for ( auto dx = -1; dx < 2; ++dx )
+            {
+                if ( (dx == 0 && dy == 0) || !b.valid(ux + dx, uy + dy) ) continue;
+
+                auto n = b.index(ux + dx, uy + dy);
+                if ( !step(b, u, n) ) continue;
+
+                auto d = mDist[u] + cOctileScoring::cost(std::abs(dx), std::abs(dy));
+                if ( d >= mDist[n] ) continue;
+
+                mDist[n] = d;
+                mParent[n] = u;
+                if ( mOpen.contains(n) ) mOpen.decrease(n, d);
+                else mOpen.push(n, d);
+            }
+    }
+}
+
+void cPathTree::build(const cBoard& b, const cNodeID& source, bool cornerCutting)
+{
+    mSource = source;
+    mCornerCutting = cornerCutting;
+    mDist.assign(b.size(), npos);
+    mParent.assign(b.size(), npos);
+    mOpen.resize(b.size());
+    mSettled = 0;
+    mBuilt = true;
+
+    if ( b.blocked(source.x, source.y) ) return;
+
+    auto s = b.index(source.x, source.y);
+    mDist[s] = 0;
+    mOpen.push(s, 0);
+    settle(b);
+}
+
+void cPathTree::cut(const cBoard& b, unsigned int cell, std::vector<unsigned int>& orphans)
+{
+    // "orphans" doubles as the work list: everything from "first" on
+    // still has its children to be cut.
+    auto first = orphans.size();
+    mDist[cell] = npos;
+    orphans.push_back(cell);
+
+    for ( auto k = first; k < orphans.size(); ++k )
+    {
+        auto u = orphans[k];
+        long ux = u % b.width(), uy = u / b.width();
+
+        for ( auto dy = -1; dy < 2; ++dy )
+            for ( auto dx = -1; dx < 2; ++dx )
+            {
+                if ( (dx == 0 && dy == 0) || !b.valid(ux + dx, uy + dy) ) continue;
+
+                auto n = b.index(ux + dx, uy + dy);
+                if ( mDist[n] == npos || mParent[n] != u ) continue;
+
+                mDist[n] = npos;
+                orphans.push_back(n);
+            }
+    }
+}
+
+void cPathTree::update(const cBoard& b, const cNodeID& a, const cNodeID& c)
+{
+    if ( !mBuilt ) return;
+    mSettled = 0;
+
+    // Steps that start, end or cut a corner in the edited rectangle all
+    // lie within it, grown by one tile.
+    long left = std::max(0, std::min(a.x, c.x) - 1);
+    long top = std::max(0, std::min(a.y, c.y) - 1);
+    long right = std::min<long>(b.width() - 1, std::max(a.x, c.x) + 1);
+    long bottom = std::min<long>(b.height() - 1, std::max(a.y, c.y) + 1);
+
+    auto source = b.valid(mSource.x, mSource.y) ? b.index(mSource.x, mSource.y) : npos;
+
+    std::vector<unsigned int> orphans;
+    for ( auto y = top; y <= bottom; ++y )
+        for ( auto x = left; x <= right; ++x )
+        {
+            auto i = b.index(x, y);
+            if ( mDist[i] == npos ) continue;
+
+            bool broken = i == source ? b.blocked(x, y) : !step(b, mParent[i], i);
+            if ( broken ) cut(b, i, orphans);
+        }
+
+    // First guesses for the orphans, from the neighbours that kept their
+    // distances.
+    for ( auto o : orphans )
+    {
+        long ox = o % b.width(), oy = o / b.width();
+        mParent[o] = npos;
+
+        for ( auto dy = -1; dy < 2; ++dy )
+            for ( auto dx = -1; dx < 2; ++dx )
+            {
+                if ( (dx == 0 && dy == 0) || !b.valid(ox + dx, oy + dy) ) continue;
+
+                auto n = b.index(ox + dx, oy + dy);
+                if ( mDist[n] == npos || !step(b, n, o) ) continue;
+
+                auto d = mDist[n] + cOctileScoring::cost(std::abs(dx), std::abs(dy));
+                if ( d < mDist[o] )
+                {
+                    mDist[o] = d;
+                    mParent[o] = n;
+                }
+            }
+
+        if ( mDist[o] != npos ) mOpen.push(o, mDist[o]);
+    }
+
+    if ( source != npos && mDist[source] == npos && !b.blocked(mSource.x, mSource.y) )
+    {
+        mDist[source] = 0;
+        mParent[source] = npos;
+        mOpen.push(source, 0);
+    }
+
+    // Anything around the edit may now have a shorter way out.
+    for ( auto y = top; y <= bottom; ++y )
+        for ( auto x = left; x <= right; ++x )
+        {
+            auto i = b.index(x, y);
+            if ( mDist[i] != npos && !mOpen.contains(i) ) mOpen.push(i, mDist[i]);
+        }
+
+    settle(b);
+}
+
+std::vector<cNodeID> cPathTree::pathTo(const cBoard& b, const cNodeID& goal) const
+{
+    std::vector<cNodeID> path;
+    if ( !mBuilt || distance(b, goal) == npos ) return path;
+
+    for ( auto i = b.index(goal.x, goal.y); i != npos; i = mParent[i] )
+        path.push_back(b.node(i));
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,83 @@
+#ifndef __small_astartest__pathTree__
+#define __small_astartest__pathTree__
+
+#include <vector>
+#include "board.h"
+#include "indexedHeap.h"
+#include "nodeID.h"
+
+// Shortest path tree from a single source: for agents that keep setting
+// out from the same place (a spawn point, or the demo's fixed start).
+//
+// build() runs Dijkstra from the source over the whole board, with octile
+// costs (see scoring.h), and keeps every tile's distance and parent. A
+// path to any goal is then just the parent chain, walked back from the
+// goal: O(path length), no search. Those paths are as short as A*'s.
+// Distances depend on whether corner cutting is allowed, so a tree is
+// built for one setting or the other, like cJumpTable.
+//
+// When the board is edited, update() repairs the tree instead of running
+// Dijkstra again:
+//
+//  - Every tile around the edit whose step from its parent is no longer
+//    allowed loses its distance, and so does its whole subtree.
+//  - Each of those tiles gets a first guess from its neighbours that kept
+//    theirs; so do the tiles around the edit, as new steps may have opened
+//    there.
+//  - Dijkstra runs from all of them, and stops when no distance improves.
+//
+// So the work is roughly proportional to the number of tiles whose
+// distance changes.
+
+class cPathTree {
+public:
+    static const unsigned int npos = ~0u;
+
+    cPathTree() { }
+
+    void        build(const cBoard&, const cNodeID& source, bool cornerCutting);
+    void        clear();
+
+    bool        built() const { return mBuilt; }
+    bool        cornerCutting() const { return mCornerCutting; }
+    cNodeID     source() const { return mSource; }
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive); repair the tree.
+    void        update(const cBoard&, const cNodeID&, const cNodeID&);
+
+    // Length of the shortest path from the source, in tenths of a tile;
+    // npos if the tile can't be reached.
+    unsigned int distance(const cBoard& b, const cNodeID& id) const
+                 {
+                     return b.valid(id.x, id.y) ? mDist[b.index(id.x, id.y)] : npos;
+                 }
+
+    // Tile by tile path from the source to the goal; empty if there's none.
+    std::vector<cNodeID> pathTo(const cBoard&, const cNodeID& goal) const;
+
+    // Tiles settled by the last build() or update().
+    unsigned long settled() const { return mSettled; }
+
+private:
+    // Whether a single step from tile a to the adjacent tile b is allowed.
+    bool        step(const cBoard&, unsigned int a, unsigned int b) const;
+
+    // Relaxes from the open list until it's empty.
+    void        settle(const cBoard&);
+
+    // Drops the distances of the tile and everything below it in the tree;
+    // the tiles go on "orphans".
+    void        cut(const cBoard&, unsigned int cell, std::vector<unsigned int>& orphans);
+
+private:
+    std::vector<unsigned int>   mDist;      // by cBoard::index; npos: unreachable
+    std::vector<unsigned int>   mParent;    // by cBoard::index; npos: none
+    cIndexedHeap<>              mOpen;      // keyed by distance
+    cNodeID                     mSource;
+    unsigned long               mSettled { 0 };
+    bool                        mBuilt { false };
+    bool                        mCornerCutting { false };
+};
+
+#endif /* defined(__small_astartest__pathTree__) */
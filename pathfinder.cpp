@@ -1,76 +1,99 @@
 #include "pathfinder.h"
+#include "line.h"
 #include "nodeID.h"
+#include "snapshot.h"
 #include <cmath>
 #include <cassert>
-#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <type_traits>
 
-int cPathFinder::UID = 1;
+namespace {
 
-inline bool cPathFinder::onCList(const cNodeID& id) const
+// Scores are 32 bits. No path costs more than one over every tile, at
+// 14 a step, and the keys of the open lists go up to twice that, plus
+// the range of the heuristic (see searchBoth()). A board on which that
+// could wrap around is turned down up front.
+uint64_t maxCost(const cBoard& b)
 {
-    if (!valid(id.x, id.y)) return false;
-    return mBoard[id.x][id.y].whichList == -UID;
+    return 14 * (uint64_t(b.size()) + b.width() + b.height());
 }
 
-inline bool cPathFinder::onOList(const cNodeID& id) const
+void checkScores(const cBoard& b)
 {
-    return valid(id.x, id.y) && mBoard[id.x][id.y].whichList == UID;
+    if ( 2 * maxCost(b) + 1 >= ~0u ) throw std::runtime_error("Board too big: path costs could overflow 32 bits.");
+}
+
+}
+
+template <typename K>
+inline bool cPathFinder::onCList(const cWorkspace& ws, const cNodeID& id) const
+{
+    if (!K::valid(mBoard, id.x, id.y)) return false;
+    return ws.mWhichList[K::index(mBoard, id.x, id.y)] == -ws.UID;
+}
+
+template <typename K>
+inline bool cPathFinder::onOList(const cWorkspace& ws, const cNodeID& id) const
+{
+    return K::valid(mBoard, id.x, id.y) && ws.mWhichList[K::index(mBoard, id.x, id.y)] == ws.UID;
 }
 
-// 500: size of the view
 cPathFinder::cPathFinder(unsigned int x, unsigned int y):
-mTileSize { 500 / x, 500 / y },
-mBoardSize { x, y }
+mBoard { x, y },
+mWorkspace { mBoard.size() }
 {
-    std::vector<cField>     col(mBoardSize.y);
-    for(auto i = 0; i < mBoardSize.x; ++i)
-    {
-        mBoard.push_back(col);
-    }
+    checkScores(mBoard);
+}
 
-    for(auto j = 0; j < mBoardSize.y; ++j)
-        for(auto i = 0; i < mBoardSize.x; ++i)
-        {
-            float left = i * mTileSize.x;
-            float top = j * mTileSize.y;
-            mGrid.push_back(sf::Vertex(sf::Vector2f(left, top), sf::Color::White));
-            mGrid.push_back(sf::Vertex(sf::Vector2f(left + mTileSize.x, top), sf::Color::White));
-            mGrid.push_back(sf::Vertex(sf::Vector2f(left + mTileSize.x,
-                                                    top + mTileSize.y), sf::Color::White));
-            mGrid.push_back(sf::Vertex(sf::Vector2f(left, top + mTileSize.y), sf::Color::White));
-        }
-        
-    q.setPred([](const listElement& a, const listElement& b) { return a < b; });
+cPathFinder::cPathFinder(unsigned int x, unsigned int y, cChunkLoader loader, size_t budget):
+mBoard { x, y, std::move(loader), budget },
+mWorkspace { mBoard.size() }
+{
+    checkScores(mBoard);
+}
+
+cPathFinder::cPathFinder(std::shared_ptr<const cSnapshot> snapshot):
+mSnapshot { std::move(snapshot) },
+mBoard { mSnapshot->width(), mSnapshot->height(), mSnapshot->rows(), mSnapshot->columns() },
+mWorkspace { mBoard.size() }
+{
+    checkScores(mBoard);
+    mSnapshot->restore(mBoard, mComponents, mJumpTable, mHierarchy);
 }
 
+template <typename K>
 unsigned int cPathFinder::calcHscore(const cNodeID& from,
                                      const cNodeID& to) const
 {
     /* Distance - estimating heuristic comes here */
-    return (abs(to.x-from.x) * 10 + abs(to.y-from.y) * 10);
+    return K::scoring::estimate(abs(to.x - from.x), abs(to.y - from.y));
 }
 
-unsigned int cPathFinder::calcGscore(const cNodeID& from,
+template <typename K>
+unsigned int cPathFinder::calcGscore(const cWorkspace& ws,
+                                     const cNodeID& from,
                                      const cNodeID& to) const
 {
+    // The gScore of the parent, plus the cost of getting here from there,
+    // however far that is.
     
-    // If not immedately next to the node, we calculate gScore simply as distance,
-    // PLUS the original gScore of the parent.
-    if ( abs(from.x - to.x) + abs(from.y - to.y) > 2 )
-    {
-        return mBoard[from.x][from.y].gScore + sqrt(pow(from.x - to.x, 2) + pow(from.y - to.y, 2)) * 10;
-    }
-
     if ( from == to ) return 0;
-    if ( from.x != to.x && from.y != to.y )
-        return mBoard[from.x][from.y].gScore + 14;
-
-    return mBoard[from.x][from.y].gScore + 10;
+    return ws.mGscore[K::index(mBoard, from.x, from.y)] +
+           K::scoring::cost(abs(from.x - to.x), abs(from.y - to.y));
 }
 
-void cPathFinder::addToOpenList(const cNodeID& target,
+template <typename K, typename Q>
+void cPathFinder::addToOpenList(cWorkspace& ws,
+                                Q& open,
+                                const cNodeID& target,
                                 const cNodeID& parent,
-                                const cNodeID& end)
+                                const cNodeID& end) const
 {
     // Adding to the open list includes:
     // - setting whichList
@@ -79,49 +102,39 @@ void cPathFinder::addToOpenList(const cNodeID& target,
     // - actually adding it to the open list.
     
     /* ... error checking ... */
-    auto x = target.x, y = target.y;
+    if (!K::valid(mBoard, target.x, target.y)) return;
     
-    if (!valid(x,y)) return;
+    auto i = K::index(mBoard, target.x, target.y);
     
-    mBoard[x][y].whichList = UID;
-    mBoard[x][y].parent = parent;
-    mBoard[x][y].gScore = calcGscore(parent, target);   // from -> to
-    mBoard[x][y].hScore = calcHscore(target, end);      // from -> to
+    ws.mWhichList[i] = ws.UID;
+    ws.mParent[i] = K::index(mBoard, parent.x, parent.y);
+    ws.mGscore[i] = calcGscore<K>(ws, parent, target);    // from -> to
     
-    q.push(listElement(target, mBoard[x][y].gScore + mBoard[x][y].hScore));
+    open.push(i, ws.mGscore[i] + calcHscore<K>(target, end));
+    SEARCH_STAT(++ws.mStats.pushes);
 }
 
-void cPathFinder::addToClosedList(const cNodeID& id)
+template <typename K>
+void cPathFinder::addToClosedList(cWorkspace& ws, const cNodeID& id) const
 {
-    if ( mBoard[id.x][id.y].whichList == UID )
-        mBoard[id.x][id.y].whichList = -UID;
+    auto i = K::index(mBoard, id.x, id.y);
+    if ( ws.mWhichList[i] == ws.UID )
+        ws.mWhichList[i] = -ws.UID;
     else
         throw std::runtime_error("Trying to add unopened to closed list.");
 }
 
-bool cPathFinder::valid(long x, long y) const
-{
-    return x >= 0 && x < mBoardSize.x && y >= 0 && y < mBoardSize.y;
-}
-
-bool cPathFinder::blocked(long int x, long int y) const
-{
-    if (!valid(x,y)) return true;
-    return mBoard[x][y].status == cStatus::blocked;
-}
-
-std::vector<cNodeID> cPathFinder::adjacent(const cNodeID& id,
-                                           bool cornerCuttingAllowed) const
+template <typename K>
+void cPathFinder::adjacent(const cNodeID& id, cNeighbours& ret) const
 {
-    std::vector<cNodeID> ret;
+    ret.clear();
     for ( auto i = -1; i < 2; ++i)
         for ( auto j = -1; j < 2; ++j )
             if ( i != 0 || j != 0 )
             {
-                if ( valid(id.x + i, id.y + j) &&
-                    mBoard[id.x + i][id.y+j].status != cStatus::blocked )
+                if ( !K::blocked(mBoard, id.x + i, id.y + j) )
                 {
-                    if ( cornerCuttingAllowed )
+                    if ( K::cornerCutting )
                     {
                         ret.push_back(cNodeID { id.x + i, id.y + j });
                     }
@@ -131,26 +144,26 @@ std::vector<cNodeID> cPathFinder::adjacent(const cNodeID& id,
 
                         // Top left corner
                         if ( i == -1 && j == -1 &&
-                            (mBoard[id.x-1][id.y].status == cStatus::blocked ||
-                             mBoard[id.x][id.y-1].status == cStatus::blocked) )
+                            (K::blocked(mBoard, id.x-1, id.y) ||
+                             K::blocked(mBoard, id.x, id.y-1)) )
                                 add = false;
                         
                         // Top right corner
                         if ( i == 1 && j == -1 &&
-                            (mBoard[id.x+1][id.y].status == cStatus::blocked ||
-                            mBoard[id.x][id.y-1].status == cStatus::blocked))
+                            (K::blocked(mBoard, id.x+1, id.y) ||
+                            K::blocked(mBoard, id.x, id.y-1)))
                                 add = false;
                         
                         // Bottom left corner
                         if ( i == -1 && j == 1 &&
-                            (mBoard[id.x-1][id.y].status == cStatus::blocked ||
-                             mBoard[id.x][id.y+1].status == cStatus::blocked))
+                            (K::blocked(mBoard, id.x-1, id.y) ||
+                             K::blocked(mBoard, id.x, id.y+1)))
                                 add = false;
                         
                         // Bottom right corner
                         if ( i == 1 && j == 1 &&
-                            (mBoard[id.x+1][id.y].status == cStatus::blocked ||
-                             mBoard[id.x][id.y+1].status == cStatus::blocked))
+                            (K::blocked(mBoard, id.x+1, id.y) ||
+                             K::blocked(mBoard, id.x, id.y+1)))
                                 add = false;
                         
                         if ( add )
@@ -158,13 +171,14 @@ std::vector<cNodeID> cPathFinder::adjacent(const cNodeID& id,
                     }
                 }
             }
-    return ret;
 }
 
-std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
-                                             const cNodeID& start,
-                                             const cNodeID& goal,
-                                             bool cornerCutting)
+template <typename K>
+void cPathFinder::successors(cWorkspace& ws,
+                             const cNodeID& target,
+                             const cNodeID& start,
+                             const cNodeID& goal,
+                             cNeighbours& ret) const
 {
 
     // So what's going to happen here? We consider the node's successors - not-necessarily-adjacent
@@ -175,11 +189,12 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
     // "coming from left" becomes true. It's a bit of fuss with the matrix, but it greatly
     // simplifies conditional evaluation - we only have to check 2 or 3 neighbours instead of 8.
     
-    auto parent = mBoard[target.x][target.y].parent;
+    auto parent = K::node(mBoard, ws.mParent[K::index(mBoard, target.x, target.y)]);
 
-    if (parent == target) return adjacent(target, cornerCutting);
+    if (parent == target) return adjacent<K>(target, ret);
     
-    std::vector<cNodeID> succ;
+    cNeighbours succ;
+    auto& mMatrix = ws.mMatrix;
     
     // First, let's set up the 3x3 matrix that represents the
     // node we're currently examining, and its 8 neighbours
@@ -203,13 +218,7 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
     mMatrix[8].x = target.x + 1;    mMatrix[8].y = target.y + 1;
     
     for (auto& i : mMatrix)
-    {
-        if (i.x < 0 || i.x >= mBoardSize.x ||
-            i.y < 0 || i.y >= mBoardSize.y ||
-            mBoard[i.x][i.y].status == cStatus::blocked) i.ok = false;
-        else
-            i.ok = true;
-    }
+        i.ok = !K::blocked(mBoard, i.x, i.y);
     
     // Now, which direction are we coming from, and is it straight or diagonal?
     
@@ -270,7 +279,7 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
         // . x 2
         // . N .
         // . . .
-        if ( mMatrix[2].ok && !mMatrix[1].ok && (cornerCutting || mMatrix[5].ok ))
+        if ( mMatrix[2].ok && !mMatrix[1].ok && (K::cornerCutting || mMatrix[5].ok ))
         {
             tmp.x = mMatrix[2].x;
             tmp.y = mMatrix[2].y;
@@ -278,7 +287,7 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
         }
             
         // Node 8: mirror image of 2
-        if ( mMatrix[8].ok && !mMatrix[7].ok && (cornerCutting || mMatrix[5].ok ))
+        if ( mMatrix[8].ok && !mMatrix[7].ok && (K::cornerCutting || mMatrix[5].ok ))
         {
             tmp.x = mMatrix[8].x;
             tmp.y = mMatrix[8].y;
@@ -367,14 +376,14 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
         // Now let's look at the forced neighbours, possibly 0 and 8.
         // 0 needs added if itself is ok, and 3 is blocked
         
-        if ( mMatrix[0].ok && !mMatrix[3].ok && (cornerCutting || mMatrix[1].ok ))
+        if ( mMatrix[0].ok && !mMatrix[3].ok && (K::cornerCutting || mMatrix[1].ok ))
         {
                 tmp.x = mMatrix[0].x;
                 tmp.y = mMatrix[0].y;
                 succ.push_back(tmp);
         }
         
-        if ( mMatrix[8].ok && !mMatrix[7].ok && (cornerCutting || mMatrix[5].ok ))
+        if ( mMatrix[8].ok && !mMatrix[7].ok && (K::cornerCutting || mMatrix[5].ok ))
         {
                 tmp.x = mMatrix[8].x;
                 tmp.y = mMatrix[8].y;
@@ -385,651 +394,1494 @@ std::vector<cNodeID> cPathFinder::successors(const cNodeID& target,
     
     // And now the jumping part...
     
-    nodevec ret;
+    ret.clear();
     for (auto& i : succ)
     {
         int dx = i.x - target.x, dy = i.y - target.y;
         assert(abs(dx) <= 1);
         assert(abs(dy) <= 1);
-        auto n = jump(target, dx, dy, start, goal, cornerCutting);
+        if ( K::engine == cEngine::jpsPlus ) SEARCH_STAT(++ws.mStats.jumps);
+        auto n = K::engine == cEngine::jpsPlus ? mJumpTable.jump(mBoard, target, dx, dy, goal) :
+                                                 jump<K>(ws, target, dx, dy, start, goal);
         if (n.valid) ret.push_back(n);
     }
-    
-    return ret;
 }
 
 
-bool    cPathFinder::has_forced_neighbour(const cNodeID &id,
-                                          int dx,
-                                          int dy) const
+namespace {
+
+// Scans a line of the board (a row, or a column) a whole word at a time.
+// Starting right after position "from" and moving by step (+1 or -1),
+// returns the first position that is either blocked, or "goal", or has a
+// forced neighbour: a tile on one of the two side lines that opens up
+// right after that side line was blocked. (That is exactly what
+// cBoard::has_forced_neighbour checks for a straight move, for 64 tiles at once.)
+// A position off the board is returned as-is; it reads as blocked.
+//
+// word(line, k) must return the k-th word of a line, 0 if off the board.
+
+template <typename Words>
+long int scanLine(Words word, long int line, long int from, int step, long int goal)
 {
-    auto nx = id.x, ny = id.y;
+    long int pos = from + step;
+    if ( pos < 0 ) return pos;
     
-    if ( dy == 0 )
+    long int k = pos >> 6;
+    
+    if ( step > 0 )
     {
-        if ( dx == 1 )  // straight, from left to right
-        {
-            return ((!blocked(nx+1, ny-1) &&    // 2 walkable
-                    blocked(nx, ny-1))          // 1 blocked
-                    ||
-                    (!blocked(nx+1, ny+1) &&    // 8 walkable
-                     blocked(nx, ny+1)));       // 7 blocked
-        }
-        
-        if (dx == -1) // straight, from right to left
+        uint64_t mask = ~uint64_t(0) << (pos & 63);
+        while ( true )
         {
-            return ((!blocked(nx-1, ny-1) &&    // 0 walkable
-                     blocked(nx, ny-1))         // 1 blocked
-                    ||
-                    (!blocked(nx-1, ny+1) &&    // 6 walkable
-                     blocked(nx, ny+1)));       // 7 blocked
+            // Bit i of "next" is the side line's tile one step further on.
+            uint64_t w = word(line, k);
+            uint64_t a = word(line - 1, k);
+            uint64_t b = word(line + 1, k);
+            uint64_t aNext = (a >> 1) | (word(line - 1, k + 1) << 63);
+            uint64_t bNext = (b >> 1) | (word(line + 1, k + 1) << 63);
+            
+            uint64_t stop = ~w | (~a & aNext) | (~b & bNext);
+            if ( goal >= 0 && (goal >> 6) == k ) stop |= uint64_t(1) << (goal & 63);
+            stop &= mask;
+            
+            if ( stop ) return (k << 6) + __builtin_ctzll(stop);
+            ++k;
+            mask = ~uint64_t(0);
         }
     }
     
-    if ( dx == 0 )
+    uint64_t mask = ~uint64_t(0) >> (63 - (pos & 63));
+    while ( k >= 0 )
     {
-        if ( dy == 1 )  // straight, from top to bottom
-        {
-            return ((!blocked(nx+1, ny+1) &&    // 8 walkable
-                     blocked(nx+1, ny))         // 5 blocked
-                    ||
-                    (!blocked(nx-1, ny+1) &&    // 6 walkable
-                     blocked(nx-1, ny)));          // 3 blocked
-        }
+        uint64_t w = word(line, k);
+        uint64_t a = word(line - 1, k);
+        uint64_t b = word(line + 1, k);
+        uint64_t aNext = (a << 1) | (word(line - 1, k - 1) >> 63);
+        uint64_t bNext = (b << 1) | (word(line + 1, k - 1) >> 63);
         
-        if ( dy == -1) // straight, from bottom to top
-        {
-            return ((!blocked(nx-1, ny-1) &&    // 0 walkable
-                     blocked(nx-1, ny))       // 3 blocked
-                    ||
-                    (!blocked(nx+1, ny-1) &&    // 2 walkable
-                     blocked(nx+1, ny)));       // 5 blocked
-        }
+        uint64_t stop = ~w | (~a & aNext) | (~b & bNext);
+        if ( goal >= 0 && (goal >> 6) == k ) stop |= uint64_t(1) << (goal & 63);
+        stop &= mask;
+        
+        if ( stop ) return (k << 6) + 63 - __builtin_clzll(stop);
+        --k;
+        mask = ~uint64_t(0);
     }
+    return -1;
+}
+
+}
+
+template <typename K>
+cNodeID cPathFinder::jump(cWorkspace& ws,
+                          const cNodeID &current,
+                          int dx,
+                          int dy,
+                          const cNodeID& start,
+                          const cNodeID& goal) const
+{
+    // Here, both dx and dy are between -1 and 1.
     
-    if ( dx > 0 && dy < 0 )
-    {
-        return ((!blocked(nx-1, ny-1) &&       // 0 walkable
-                 blocked(nx-1, ny))            // 3 blocked
-                ||
-                (!blocked(nx+1, ny+1) &&        // 8 walkable
-                 blocked(nx, ny+1)));            // 7 blocked
-    }
+    SEARCH_STAT(++ws.mStats.jumps);
     
-    if ( dx > 0 && dy > 0 )
+    // Straight jumps don't step tile by tile: the walkability bits are
+    // scanned 64 tiles at a time for the first wall, forced neighbour,
+    // or the goal. If it's a wall we found, there's no jump point on
+    // this line, and we return an invalid node.
+    
+    if ( dy == 0 )
     {
-        return ((!blocked(nx+1, ny-1) &&       // 2 walkable
-                 blocked(nx, ny-1))          // 1 blocked
-                ||
-                (!blocked(nx-1, ny+1) &&        // 6 walkable
-                 blocked(nx-1, ny)));          // 3 blocked
+        auto rows = [this](long int y, long int k) { return mBoard.rowWord(y, k); };
+        cNodeID n { static_cast<int>(scanLine(rows, current.y, current.x, dx,
+                                              goal.y == current.y ? goal.x : -1)),
+                    current.y };
+        n.valid = !K::blocked(mBoard, n.x, n.y);
+        return n;
     }
     
-    if ( dx < 0 && dy > 0 )
+    if ( dx == 0 )
     {
-        return ((!blocked(nx-1, ny-1) &&       // 0 walkable
-                 blocked(nx, ny-1))           // 1 blocked
-                ||
-                (!blocked(nx+1, ny+1) &&        // 8 walkable
-                 blocked(nx+1, ny)));            // 5 blocked
+        auto columns = [this](long int x, long int k) { return mBoard.columnWord(x, k); };
+        cNodeID n { current.x,
+                    static_cast<int>(scanLine(columns, current.x, current.y, dy,
+                                              goal.x == current.x ? goal.y : -1)) };
+        n.valid = !K::blocked(mBoard, n.x, n.y);
+        return n;
     }
     
-    if ( dx < 0 && dy < 0 )
+    // Diagonal jumps do go one step at a time, sending out a horizontal
+    // and a vertical scan line from every tile on the way.
+    
+    cNodeID n { current };
+    while ( true )
     {
-        return ((!blocked(nx+1, ny-1) &&       // 2 walkable
-                 blocked(nx+1, ny))           // 5 blocked
-                ||
-                (!blocked(nx-1, ny+1) &&        // 6 walkable
-                 blocked(nx, ny+1)));            // 7 blocked
+        n.x += dx;
+        n.y += dy;
+        
+        // If n is an obstacle or outside the grid then
+        // return an invalid node.
+        if ( K::blocked(mBoard, n.x, n.y) )
+        {
+            n.valid = false;
+            return n;
+        }
+        
+        // If n is the goal then we just return n.
+        if ( n == goal ) return n;
+        
+        // Return if there's a slipping through corners.
+        if ( !K::cornerCutting && K::blocked(mBoard, n.x+dx, n.y) && K::blocked(mBoard, n.x, n.y+dy) )
+        {
+            n.valid = false;
+            return n;
+        }
+        
+        // If n has at least one forced neighbour, then
+        // we have to return n
+        if ( mBoard.has_forced_neighbour(n, dx, dy) ) return n;
+        
+        // If no forced neighbours, send out vertical and
+        // horizontal scan lines before moving on diagonally.
+        if ( jump<K>(ws, n, 0, dy, start, goal).valid ) return n;
+        if ( jump<K>(ws, n, dx, 0, start, goal).valid ) return n;
     }
+}
+
+
+template <typename K, typename Q>
+void cPathFinder::updateOpenList(cWorkspace& ws,
+                                 Q& open,
+                                 const cNodeID& target,
+                                 const cNodeID& new_parent,
+                                 const cNodeID& end) const
+{
+    // Every cell knows where it is on the open list, so there's
+    // no need to look for it there: just lower its key.
     
+    auto i = K::index(mBoard, target.x, target.y);
     
-    // We really shouldn't be returning here, but to appease
-    // the compiler:
+    ws.mParent[i] = K::index(mBoard, new_parent.x, new_parent.y);
+    ws.mGscore[i] = calcGscore<K>(ws, new_parent, target);
     
-    return false;
+    open.decrease(i, ws.mGscore[i] + calcHscore<K>(target, end));
+    SEARCH_STAT(++ws.mStats.decreases);
 }
 
-cNodeID cPathFinder::jump(const cNodeID &current,
-                          int dx,
-                          int dy,
-                          const cNodeID& start,
-                          const cNodeID& goal,
-                          bool corcutallowed) const
+template <typename F>
+bool cPathFinder::traceLine(const cNodeID& start, const cNodeID& end, F visit) const
 {
-    // Here, both dx and dy are between -1 and 1.
-    
-    cNodeID n { current };
-    n.x += dx;
-    n.y += dy;
+    for ( cLine line { start, end }; ; line.next() )
+    {
+        if ( !visit(line.tile()) ) return false;
+        if ( line.done() ) return true;
+    }
+}
 
-    // If n is an obstacle or outside the grid then
-    // return an invalid node.
-    
-    if ( n.x < 0 || n.x >= mBoardSize.x ||
-         n.y < 0 || n.y >= mBoardSize.y ||
-        mBoard[n.x][n.y].status == cStatus::blocked )
+bool cPathFinder::lineOfSight(cSearchStats& stats,
+                              const cNodeID& a,
+                              const cNodeID& b,
+                              bool cornerCutting) const
+{
+    (void)stats;            // with PATHFINDER_STATS=0, SEARCH_STAT drops it
+    SEARCH_STAT(++stats.lineChecks);
+    
+    // The same line as traceLine(), in runs: along the major axis (x for
+    // a horizontal-like line, y for a vertical-like one), the tiles that
+    // share a minor coordinate are next to each other, and make a row or
+    // column segment that the board checks a word at a time. Runs are
+    // joined by diagonal steps, and without corner cutting such a step
+    // also needs the two tiles beside it: those are the ones just past
+    // either end of a run, so each run is checked one tile longer at
+    // either end (except at the ends of the line).
+    
+    int adx = abs(b.x - a.x), ady = abs(b.y - a.y);
+    bool horizontal = adx > ady;
+    
+    int du = horizontal ? adx : ady, dv = horizontal ? ady : adx;
+    int su = horizontal ? (b.x > a.x) - (b.x < a.x) : (b.y > a.y) - (b.y < a.y);
+    int sv = horizontal ? (b.y > a.y) - (b.y < a.y) : (b.x > a.x) - (b.x < a.x);
+    int u = horizontal ? a.x : a.y, v = horizontal ? a.y : a.x;
+    int uEnd = horizontal ? b.x : b.y;
+    int grow = cornerCutting ? 0 : su;
+    int tmp = du / 2;
+    
+    for ( bool first = true; ; first = false )
     {
-        n.valid = false;
-        return n;
+        // Steps along the major axis until the next minor one, with the
+        // same arithmetic as traceLine().
+        int steps;
+        if ( dv == 0 ) steps = du + 1;
+        else if ( horizontal ) steps = (du - tmp + dv - 1) / dv;
+        else steps = du == dv ? 1 : (du - tmp) / dv + 1;
+        
+        bool last = steps > abs(uEnd - u);
+        int from = first ? u : u - grow;
+        int to = last ? uEnd : u + su * (steps - 1) + grow;
+        
+        if ( !(horizontal ? mBoard.clearRow(v, from, to) : mBoard.clearColumn(v, from, to)) ) return false;
+        if ( last ) return true;
+        
+        u += su * steps;
+        v += sv;
+        tmp += steps * dv - du;
     }
+}
 
-    // If n is the goal then we just return n.
-    if ( n == goal ) return n;
-    
-    // Return if there's a slipping through corners.
-    if ( !corcutallowed && dx != 0 && dy != 0 )
+void cPathFinder::drawPath(const std::vector<cNodeID>& waypoints, std::vector<cNodeID>& tiles) const
+{
+    tiles.clear();
+    for ( size_t i = 1; i < waypoints.size(); ++i )
     {
-        if (blocked(n.x+dx, n.y) && blocked(n.x, n.y+dy))
+        // Each line starts where the last one ended.
+        if ( !tiles.empty() ) tiles.pop_back();
+        traceLine(waypoints[i - 1], waypoints[i], [&tiles](const cNodeID& t)
         {
-            n.valid = false;
-            return n;
-        }
+            tiles.push_back(t);
+            return true;
+        });
     }
-    
-    // If n has at least one forced neighbour, then
-    // we have to return n
-    if ( has_forced_neighbour(n, dx, dy) ) return n;
+    if ( waypoints.size() == 1 ) tiles.push_back(waypoints.front());
+}
 
-    // If no forced neighbours, and we're going diagonally,
-    // first send out vertical and horizontal scan lines
-    if ( dx != 0 && dy != 0 )
+void cPathFinder::smoothPath(cSearchStats& stats,
+                             const std::vector<cNodeID>& path,
+                             bool cornerCutting,
+                             std::vector<cNodeID>& waypoints) const
+{
+    // String pulling, in a single pass. Only turning points (where the
+    // path changes direction) can be kept; from the last point kept, the
+    // line goes on to each turning point in turn while it can still be
+    // seen, and the one before is kept when it can't. One line check per
+    // turning point; drawing the tiles is up to the caller.
+    
+    if ( path.size() <= 2 )
     {
-        if ( jump(n, 0, dy, start, goal, corcutallowed).valid ) return n;
-        if ( jump(n, dx, 0, start, goal, corcutallowed).valid ) return n;
+        waypoints.assign(path.begin(), path.end());
+        return;
     }
     
-    // When push comes to shove, OK, fair enough, shoot
-    // those diagonal jumps too
+    auto direction = [](const cNodeID& from, const cNodeID& to)
+    {
+        return cNodeID { (to.x > from.x) - (to.x < from.x), (to.y > from.y) - (to.y < from.y) };
+    };
+    
+    waypoints.assign(1, path.front());
+    auto anchor = path.front();
+    auto seen = anchor;         // the last turning point in sight of the anchor
     
-    return jump(n, dx, dy, start, goal, corcutallowed);
+    for ( size_t i = 1; i < path.size(); ++i )
+    {
+        bool turning = i + 1 == path.size() ||
+                       direction(path[i - 1], path[i]) != direction(path[i], path[i + 1]);
+        if ( !turning ) continue;
+        
+        // Straight on from the anchor needs no check: that's the path itself.
+        if ( seen != anchor && !lineOfSight(stats, anchor, path[i], cornerCutting) )
+        {
+            waypoints.push_back(seen);
+            anchor = seen;
+        }
+        seen = path[i];
+    }
+    waypoints.push_back(path.back());
 }
 
-
-void cPathFinder::updateOpenList(const cNodeID& target,
-                                 const cNodeID& new_parent)
+template <typename K>
+void cPathFinder::neighbours(cWorkspace& ws,
+                             const cNodeID& current,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             cNeighbours& out) const
 {
-    auto x = target.x, y = target.y;
-    listElement old { target, mBoard[x][y].gScore + mBoard[x][y].hScore };
-    
-    mBoard[x][y].parent = new_parent;
-    mBoard[x][y].gScore = calcGscore(new_parent, target);
+
+    // This is the rub. Jump point search differs from basic A* in the way it finds the
+    // neighbours of any given node. For JPS, a neighbour need not be immediately adjacent
+    // to the node we're considering.
     
-    listElement tmp { target, mBoard[x][y].gScore + mBoard[x][y].hScore };
-    q.replace(old, tmp);
+    return K::jps ? successors<K>(ws, current, start, end, out) : adjacent<K>(current, out);
 }
 
-std::vector<cNodeID> cPathFinder::walkable(const cNodeID& start,
-                                           const cNodeID& end) const
+void cPathFinder::buildJumpTable(bool corCutAllowed)
 {
-    // Attempts to draw a straight line from start to end;
-    // if this can be done, returns each of the line's points;
-    // if not, returns an empty vector.
-    
-    static std::vector<cNodeID> empty_one;
-    cNodeID step, current = start;
-    std::vector<cNodeID> ret;
+    if ( !mJumpTable.built() || mJumpTable.cornerCutting() != corCutAllowed )
+        mJumpTable.build(mBoard, corCutAllowed);
+}
+
+void cPathFinder::buildHierarchy(bool corCutAllowed)
+{
+    if ( !mHierarchy.built() || mHierarchy.cornerCutting() != corCutAllowed )
+        mHierarchy.build(mBoard, corCutAllowed);
+}
+
+void cPathFinder::buildPathTree(const cNodeID& source, bool corCutAllowed)
+{
+    if ( !mTree.built() || mTree.source() != source || mTree.cornerCutting() != corCutAllowed )
+        mTree.build(mBoard, source, corCutAllowed);
+}
+
+void cPathFinder::buildComponents(bool corCutAllowed)
+{
+    if ( !mComponents.built() || mComponents.cornerCutting() != corCutAllowed )
+        mComponents.build(mBoard, corCutAllowed);
+}
+
+void cPathFinder::saveSnapshot(const std::string& file) const
+{
+    cSnapshot::save(file, mBoard, mComponents, mJumpTable, mHierarchy);
+}
+
+template <typename K, typename Q>
+void cPathFinder::search(cWorkspace& ws,
+                         Q& open,
+                         const cNodeID& start,
+                         const cNodeID& end) const
+{
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    cNodeID                 currentNode { start };
+    cStatTimer              searching { ws.mStats.searchMicros };
     
-    // First divide line into vertical and horizontal components
-    int dx = end.x - start.x, dy = end.y - start.y;
-    step.x = ( dx > 0 ) - ( dx < 0 );
-    step.y = ( dy > 0 ) - ( dy < 0 );
+    addToOpenList<K>(ws, open, currentNode, currentNode, end);
     
-    // We distinguish between 2 basic cases: horizontal and vertical-like
-    // lines. That's important because getting this wrong might result
-    // in a wrong number of points drawn ( e.g. a line from 9:10 to 11:20,
-    // only 3 points are drawn if we try to draw this as horizontal.
+    // "open:" the priority queue of nodes on the open list
     
-    int adx = abs(dx), ady = abs(dy);
-
-    if ( adx > ady ) //horizontal line
+    while ( !onCList<K>(ws, end) && !open.empty() )
     {
-        // tmp keeps track of when we need to increment / decrement the
-        // other variable, e.g. when drawing a horizontal line, when do
-        // we make a vertical step. for an evenly distributed line,
-        // this should start from half of the other component.
+        currentNode = K::node(mBoard, open.pop_and_get());
+        addToClosedList<K>(ws, currentNode);
+        SEARCH_STAT(++ws.mStats.expanded);
         
-        int tmp = adx / 2;
-        while ( current != end )
-        {
-            if ( blocked(current.x, current.y) )
-                return empty_one;   // can't draw line.
-            else ret.push_back(current);
-            current.x += step.x;
-            tmp += ady;
-            if ( tmp >= adx )
+        neighbours<K>(ws, currentNode, start, end, next);
+        for (auto& i : next)
+            if ( !onCList<K>(ws, i) )
             {
-                tmp -= adx; current.y += step.y;
+                if ( !onOList<K>(ws, i) )
+                {
+                    addToOpenList<K>(ws, open, i, currentNode, end);
+                }
+                else
+                {
+                    if ( calcGscore<K>(ws, currentNode, i) < ws.mGscore[K::index(mBoard, i.x, i.y)] )
+                    {
+                         updateOpenList<K>(ws, open, i, currentNode, end);
+                    }
+                }
             }
-        }
-        
-        // Add last point:
-        ret.push_back(end);
-        return ret;
-    } else // vertical line
+    }
+    
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
+    
+    path.clear();
+    if ( onCList<K>(ws, end) ) // path found!
     {
-        int tmp = ady / 2;
-        while ( current != end )
+        auto tmp = K::index(mBoard, end.x, end.y);
+        while ( ws.mParent[tmp] != tmp )
         {
-            if ( blocked(current.x, current.y))
-                return empty_one;
-            else ret.push_back(current);
-            
-            current.y += step.y;
-            tmp += adx;
-            if ( tmp > ady )
-            {
-                tmp -= ady;
-                current.x += step.x;
-            }
+            path.push_back(K::node(mBoard, tmp));
+            tmp = ws.mParent[tmp];
         }
-        ret.push_back(end);
-        return ret;
+        path.push_back(K::node(mBoard, tmp));
+        std::reverse(path.begin(), path.end());
     }
+    
+    open.clear();           // Flush the open list; very important to do
+                            // after each pathfinding!
 }
 
-std::vector<cNodeID> cPathFinder::smoothPath(const std::vector<cNodeID>& path) const
+template <typename K, typename Q>
+void cPathFinder::searchAnyAngle(cWorkspace& ws,
+                                 Q& open,
+                                 const cNodeID& start,
+                                 const cNodeID& end) const
 {
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    cStatTimer              searching { ws.mStats.searchMicros };
+    
+    addToOpenList<K>(ws, open, start, start, end);
     
-    // Smooths out a path by trying to eliminate waypoints - a waypoint is where the path
-    // changes directions
+    while ( !onCList<K>(ws, end) && !open.empty() )
+    {
+        auto i = open.pop_and_get();
+        auto currentNode = K::node(mBoard, i);
+        addToClosedList<K>(ws, currentNode);
+        SEARCH_STAT(++ws.mStats.expanded);
+        
+        auto parent = K::node(mBoard, ws.mParent[i]);
+        adjacent<K>(currentNode, next);
+        
+        // Lazy Theta* took the line to the parent on trust. If it isn't
+        // there after all, the node makes do with its best closed neighbour;
+        // there's always one, the node that opened it.
+        if ( K::engine == cEngine::lazyTheta && !lineOfSight(ws.mStats, parent, currentNode, K::cornerCutting) )
+        {
+            ws.mGscore[i] = ~0u;
+            for ( auto& n : next )
+                if ( onCList<K>(ws, n) && calcGscore<K>(ws, n, currentNode) < ws.mGscore[i] )
+                {
+                    ws.mGscore[i] = calcGscore<K>(ws, n, currentNode);
+                    ws.mParent[i] = K::index(mBoard, n.x, n.y);
+                }
+            parent = K::node(mBoard, ws.mParent[i]);
+        }
+        
+        for ( auto& n : next )
+        {
+            if ( onCList<K>(ws, n) ) continue;
+            
+            // Skip the current node, and go straight from its parent, if
+            // that can be seen from here (Theta*), or may be (Lazy Theta*).
+            auto from = currentNode;
+            if ( K::engine == cEngine::lazyTheta || lineOfSight(ws.mStats, parent, n, K::cornerCutting) ) from = parent;
+            
+            if ( !onOList<K>(ws, n) )
+                addToOpenList<K>(ws, open, n, from, end);
+            else if ( calcGscore<K>(ws, from, n) < ws.mGscore[K::index(mBoard, n.x, n.y)] )
+                updateOpenList<K>(ws, open, n, from, end);
+        }
+    }
     
-    auto size = path.size();
-    if ( size <= 2 ) return path;
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
     
-    if ( mJPS == true )
+    path.clear();
+    if ( onCList<K>(ws, end) )
     {
-        std::vector<cNodeID> smoothPath;
-        auto it = path.begin();
-        auto end = path.end();
+        for ( auto i = K::index(mBoard, end.x, end.y); ; i = ws.mParent[i] )
+        {
+            path.push_back(K::node(mBoard, i));
+            if ( ws.mParent[i] == i ) break;
+        }
+        std::reverse(path.begin(), path.end());
+    }
+    
+    open.clear();
+}
 
-        // Next one: immediately near the node we're checking
-        auto next = it; ++next;
-        
-        // Target: the one where we'd like to jump
-        auto target = next; ++target;
+template <typename K, typename Q>
+void cPathFinder::searchAnytime(cWorkspace& ws,
+                                Q& open,
+                                const cNodeID& start,
+                                const cNodeID& end) const
+{
+    // ARA* (Likhachev, Gordon and Thrun, 2003). Each round is a weighted
+    // A* that expands every node at most once, and stops as soon as no
+    // open key is below the goal's g. A node whose g drops after it has
+    // been expanded goes on mInconsistent instead of back on the open
+    // list; the next round, with less weight, starts from all of those
+    // and everything still open, with the g scores found so far.
+    //
+    // Every round gets a stamp of its own, so that nodes closed in an
+    // earlier round count as neither open nor closed, but their g scores
+    // still count: any stamp from "first" on means the node was reached
+    // during this query.
+    //
+    // The bound: a node on a shortest path, with its g already right, is
+    // always open or inconsistent, so the lowest g + h among those is
+    // never more than the shortest path's cost.
+
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    auto&                   inconsistent = ws.mInconsistent;
+    cStatTimer              searching { ws.mStats.searchMicros };
+    auto                    began = std::chrono::steady_clock::now();
+    bool                    anytime = mSuboptimal == cSuboptimal::anytime;
+    double                  weight = mWeight;
+    double                  bound = weight;
+    unsigned long           expansions { 0 };
+    bool                    outOfBudget { false };
+
+    const int   first = ws.UID;
+    auto        s = K::index(mBoard, start.x, start.y);
+    auto        goal = K::index(mBoard, end.x, end.y);
+    auto        reached = [&](unsigned int i) { return std::abs(ws.mWhichList[i]) >= first; };
+    auto        estimate = [&](unsigned int i) { return calcHscore<K>(K::node(mBoard, i), end); };
+    auto        key = [&](unsigned int i)
+                {
+                    return ws.mGscore[i] + static_cast<unsigned int>(weight * estimate(i));
+                };
 
-        // We can add the first point w/o problem.
-        smoothPath.push_back(*it);
-        ++it;
+    inconsistent.clear();
+    ws.mWhichList[s] = ws.UID;
+    ws.mParent[s] = s;
+    ws.mGscore[s] = 0;
+    open.push(s, key(s));
+    SEARCH_STAT(++ws.mStats.pushes);
 
-        bool jmp { false };
-        nodevec lastJump;
-       
-        while ( next != end )
+    while ( true )
+    {
+        while ( !open.empty() && (!reached(goal) || ws.mGscore[goal] > open.topKey()) )
         {
-            jmp = false;
-            
-            // Jump as far as we can
-            bool cnt { true };
-            while ( target != end && cnt == true)
+            if ( anytime &&
+                 ((mExpansionBudget && expansions >= mExpansionBudget) ||
+                  (mDeadlineMicros > 0 && expansions % 64 == 0 &&
+                   std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - began).count() >=
+                   mDeadlineMicros)) )
+            {
+                outOfBudget = true;
+                break;
+            }
+
+            auto i = open.pop_and_get();
+            auto currentNode = K::node(mBoard, i);
+            ws.mWhichList[i] = -ws.UID;
+            ++expansions;
+            SEARCH_STAT(++ws.mStats.expanded);
+
+            neighbours<K>(ws, currentNode, start, end, next);
+            for ( auto& n : next )
             {
-                nodevec vec = walkable(*it, *target);
-                if ( vec.size() != 0 ) // we CAN jump over
+                auto j = K::index(mBoard, n.x, n.y);
+                auto g = calcGscore<K>(ws, currentNode, n);
+                if ( reached(j) && g >= ws.mGscore[j] ) continue;
+
+                ws.mGscore[j] = g;
+                ws.mParent[j] = i;
+                if ( ws.mWhichList[j] == -ws.UID )
+                    inconsistent.push_back(j);
+                else if ( ws.mWhichList[j] == ws.UID )
                 {
-                    lastJump.clear();
-                    std::copy(vec.begin(), vec.end(), std::back_inserter(lastJump));
-                    ++target;
-                    jmp = true;
+                    open.decrease(j, key(j));
+                    SEARCH_STAT(++ws.mStats.decreases);
                 }
                 else
                 {
-                    --target;
-                    cnt = false;
+                    ws.mWhichList[j] = ws.UID;
+                    open.push(j, key(j));
+                    SEARCH_STAT(++ws.mStats.pushes);
                 }
             }
-            
-            if ( cnt == true ) --target;
-            
-            if ( jmp )
+        }
+
+        // Whatever is still open joins the inconsistent nodes, both for
+        // the bound and for the next round.
+        while ( !open.empty() ) inconsistent.push_back(open.pop_and_get());
+
+        if ( !reached(goal) ) break;
+
+        auto lowest = ws.mGscore[goal];
+        for ( auto i : inconsistent ) lowest = std::min(lowest, ws.mGscore[i] + estimate(i));
+        bound = std::min(bound, lowest > 0 ? double(ws.mGscore[goal]) / lowest : 1.0);
+
+        if ( !anytime || outOfBudget || weight == 1 || bound <= 1 ) break;
+
+        auto lighter = 1 + (weight - 1) / 2;
+        weight = std::min(bound, lighter < 1.05 ? 1.0 : lighter);
+        ++ws.UID;
+        for ( auto i : inconsistent )
+            if ( ws.mWhichList[i] != ws.UID )
+            {
+                ws.mWhichList[i] = ws.UID;
+                open.push(i, key(i));
+            }
+        inconsistent.clear();
+    }
+
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
+
+    path.clear();
+    if ( reached(goal) )
+    {
+        for ( auto i = goal; ; i = ws.mParent[i] )
+        {
+            path.push_back(K::node(mBoard, i));
+            if ( ws.mParent[i] == i ) break;
+        }
+        std::reverse(path.begin(), path.end());
+        ws.mBound = std::max(bound, 1.0);
+    }
+
+    open.clear();
+    inconsistent.clear();
+}
+
+template <typename K>
+void cPathFinder::searchFocal(cWorkspace& ws,
+                              const cNodeID& start,
+                              const cNodeID& end) const
+{
+    // Focal search (Pearl and Kim, 1982). mHeap holds every open node by
+    // f = g + h, so its top is the lowest f, fMin; mFocal holds those with
+    // f <= w * fMin, by h, and mWaiting the rest, by f. fMin never goes
+    // down (h is consistent), so nodes only ever move from mWaiting to
+    // mFocal. A node's g can still improve after it has been expanded,
+    // since nodes aren't expanded in order of f; it's opened again then.
+    //
+    // The bound: some node on a shortest path, with its g already right,
+    // is always open, so fMin is never more than the shortest path's
+    // cost, and the goal comes off mFocal with g <= w * fMin.
+
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    auto&                   open = ws.mHeap;
+    auto&                   focal = ws.mFocal;
+    auto&                   waiting = ws.mWaiting;
+    cStatTimer              searching { ws.mStats.searchMicros };
+
+    auto        goal = K::index(mBoard, end.x, end.y);
+    uint64_t    limit { 0 };    // w * fMin
+    auto        place = [&](unsigned int i, unsigned int h)
+                {
+                    auto f = ws.mGscore[i] + h;
+                    if ( focal.contains(i) ) return;
+                    if ( f <= limit )
+                    {
+                        if ( waiting.contains(i) ) waiting.remove(i);
+                        focal.push(i, h);
+                    }
+                    else if ( waiting.contains(i) ) waiting.decrease(i, f);
+                    else waiting.push(i, f);
+                };
+
+    addToOpenList<K>(ws, open, start, start, end);
+    focal.push(K::index(mBoard, start.x, start.y), calcHscore<K>(start, end));
+
+    while ( !open.empty() )
+    {
+        limit = static_cast<uint64_t>(mWeight * open.topKey());
+        while ( !waiting.empty() && waiting.topKey() <= limit )
+        {
+            auto i = waiting.pop_and_get();
+            focal.push(i, calcHscore<K>(K::node(mBoard, i), end));
+        }
+
+        auto i = focal.pop_and_get();
+        open.remove(i);
+        auto currentNode = K::node(mBoard, i);
+        addToClosedList<K>(ws, currentNode);
+        SEARCH_STAT(++ws.mStats.expanded);
+        if ( i == goal ) break;
+
+        neighbours<K>(ws, currentNode, start, end, next);
+        for ( auto& n : next )
+        {
+            auto j = K::index(mBoard, n.x, n.y);
+            auto h = calcHscore<K>(n, end);
+            if ( onOList<K>(ws, n) )
             {
-                for ( auto&& a : lastJump )
-                    smoothPath.push_back(std::move(a));
-                it = target;
-                next = it; ++next;
-                target = next; ++target;
+                if ( calcGscore<K>(ws, currentNode, n) >= ws.mGscore[j] ) continue;
+                updateOpenList<K>(ws, open, n, currentNode, end);
             }
-            else        // no jump here
+            else if ( onCList<K>(ws, n) )
             {
-                auto vec = walkable(*it, *next);
-                for ( auto&& a : vec )
-                    smoothPath.push_back(std::move(a));
-                it = next;
-                ++next;
-                ++target;
+                if ( calcGscore<K>(ws, currentNode, n) >= ws.mGscore[j] ) continue;
+                ws.mWhichList[j] = ws.UID;
+                ws.mParent[j] = i;
+                ws.mGscore[j] = calcGscore<K>(ws, currentNode, n);
+                open.push(j, ws.mGscore[j] + h);
+                SEARCH_STAT(++ws.mStats.pushes);
             }
+            else addToOpenList<K>(ws, open, n, currentNode, end);
+            place(j, h);
         }
-        
-        return smoothPath;
+    }
+
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
+
+    path.clear();
+    if ( onCList<K>(ws, end) )
+    {
+        for ( auto i = goal; ; i = ws.mParent[i] )
+        {
+            path.push_back(K::node(mBoard, i));
+            if ( ws.mParent[i] == i ) break;
+        }
+        std::reverse(path.begin(), path.end());
+
+        auto g = ws.mGscore[goal];
+        auto lowest = open.empty() ? g : std::min(g, open.topKey());
+        ws.mBound = std::min(mWeight, lowest > 0 ? double(g) / lowest : 1.0);
+    }
 
+    open.clear();
+    focal.clear();
+    waiting.clear();
+}
+
+template <typename K, typename Q>
+void cPathFinder::searchBoth(cWorkspace& ws,
+                             Q& forward,
+                             Q& backward,
+                             const cNodeID& start,
+                             const cNodeID& end) const
+{
+    // Two searches, one from either end; whichever side has the shorter
+    // open list expands next. The backward side swaps its arrays into the
+    // workspace while it does, so the helpers above work on either side.
+    //
+    // Plain A* from both ends doesn't pay: each side would expand almost
+    // everything a single search does before it could be sure. So both
+    // sides are ordered by the same "balanced" estimate instead, half the
+    // distance left to the own goal minus half the distance covered from
+    // the other end: p(v) = (h(v, goal) - h(v, start)) / 2 forward, and
+    // -p(v) backward. With a consistent heuristic, that's a bidirectional
+    // Dijkstra on nonnegative reduced costs. Keys are doubled to stay in
+    // integers, and shifted by "offset" to stay nonnegative.
+    //
+    // Whenever a side reaches a node the other side has reached too,
+    // that's a path: "best" is the shortest seen so far, and "meet" the
+    // node it goes through. The search stops when neither side, nor the
+    // two together, can offer anything shorter.
+    
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    cStatTimer              searching { ws.mStats.searchMicros };
+    
+    path.clear();
+    if ( start == end )
+    {
+        path.push_back(start);
+        return;
     }
     
-    std::vector<size_t> waypointIDs;
-    waypointIDs.push_back(0);
+    bool swapped { false };
+    auto swapSides = [&ws, &swapped]()
+    {
+        std::swap(ws.mGscore, ws.mGscoreB);
+        std::swap(ws.mParent, ws.mParentB);
+        std::swap(ws.mWhichList, ws.mWhichListB);
+        swapped = !swapped;
+    };
+    
+    // A chunk loader may throw mid-search (see cBoard); whatever runs in
+    // this workspace next needs the sides the right way round.
+    struct cUnswap {
+        cWorkspace&     ws;
+        bool&           swapped;
+        ~cUnswap()
+        {
+            if ( !swapped ) return;
+            std::swap(ws.mGscore, ws.mGscoreB);
+            std::swap(ws.mParent, ws.mParentB);
+            std::swap(ws.mWhichList, ws.mWhichListB);
+        }
+    } unswap { ws, swapped };
+
+    unsigned int    best { ~0u };
+    unsigned int    meet { 0 };
+    
+    // +1: rounding may cost the heuristic's triangle inequality a unit.
+    const long long offset = calcHscore<K>(start, end) + 1;
     
-    cNodeID incoming;
-    cNodeID outgoing;
+    auto relax = [&](Q& open, const cNodeID& v, const cNodeID& parent, const cNodeID& from, const cNodeID& to)
+    {
+        auto n = K::index(mBoard, v.x, v.y);
+        auto g = calcGscore<K>(ws, parent, v);
+        bool queued = ws.mWhichList[n] == ws.UID;
+        if ( queued && g >= ws.mGscore[n] ) return;
+        
+        ws.mWhichList[n] = ws.UID;
+        ws.mParent[n] = K::index(mBoard, parent.x, parent.y);
+        ws.mGscore[n] = g;
+        
+        unsigned int key = 2 * g + calcHscore<K>(v, to) + offset - calcHscore<K>(v, from);
+        if ( queued )
+        {
+            open.decrease(n, key);
+            SEARCH_STAT(++ws.mStats.decreases);
+        }
+        else
+        {
+            open.push(n, key);
+            SEARCH_STAT(++ws.mStats.pushes);
+        }
+        
+        // The other side's arrays are the B ones now, whichever that is.
+        if ( (ws.mWhichListB[n] == ws.UID || ws.mWhichListB[n] == -ws.UID) &&
+             g + ws.mGscoreB[n] < best )
+        {
+            best = g + ws.mGscoreB[n];
+            meet = n;
+        }
+    };
     
-    // Fill up a temporary vector of waypoints. A waypoint is a node
-    // whose outgoing direction is not the same as its incoming one.
-    // Like, "turning points."
+    relax(forward, start, start, start, end);
+    swapSides();
+    relax(backward, end, end, end, start);
+    swapSides();
     
-    for ( auto i = 1; i < size-1; ++i )
+    while ( !forward.empty() || !backward.empty() )
     {
-        incoming = path[i] - path[i-1];
-        outgoing = path[i+1] - path[i];
-        if ( outgoing != incoming ) waypointIDs.push_back(i);
+        // Twice the lower bound on any path not seen yet. A side may run
+        // dry before the other: moves aren't always reversible (JPS without
+        // corner cutting), so that doesn't mean there's no path.
+        long long bound { 0 };
+        if ( !forward.empty() ) bound = std::max(bound, forward.topKey() - 1ll);
+        if ( !backward.empty() ) bound = std::max(bound, backward.topKey() - 1ll);
+        if ( !K::jps && !forward.empty() && !backward.empty() )
+            bound = std::max(bound, 0ll + forward.topKey() + backward.topKey() - 2 * offset);
+        if ( 2ll * best <= bound ) break;
+        
+        bool back = forward.empty() || (!backward.empty() && backward.getSize() < forward.getSize());
+        auto& open = back ? backward : forward;
+        auto& from = back ? end : start;
+        auto& to = back ? start : end;
+        
+        if ( back ) swapSides();
+        
+        auto currentNode = K::node(mBoard, open.pop_and_get());
+        addToClosedList<K>(ws, currentNode);
+        SEARCH_STAT(++ws.mStats.expanded);
+        
+        neighbours<K>(ws, currentNode, from, to, next);
+        for (auto& i : next)
+            if ( !onCList<K>(ws, i) )
+                relax(open, i, currentNode, from, to);
+        
+        if ( back ) swapSides();
     }
-    waypointIDs.push_back(size-1);
     
-    // Now let's check if there are points to eliminate.
-    std::vector<cNodeID> repl;  // replacement
-    std::map<cNodeID, std::vector<cNodeID>> redrawn;
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
     
-    for ( auto it = waypointIDs.begin(); it != waypointIDs.end(); ++it )
-        if ( *it != 0 && *it != size-1 )
+    if ( best != ~0u )
+    {
+        for ( auto tmp = meet; ; tmp = ws.mParent[tmp] )
         {
-            auto prev = it - 1;
-            auto next = it + 1;
-            repl = walkable(path[*prev], path[*next]);
-            if ( !repl.empty() )
-            {
-                redrawn.insert(std::pair<cNodeID, std::vector<cNodeID>> { cNodeID( *prev, *next), repl });
-                it = waypointIDs.erase(it);
-            }
+            path.push_back(K::node(mBoard, tmp));
+            if ( ws.mParent[tmp] == tmp ) break;
         }
-    
-    // Now we have the waypoints and their connecting lines, yay!
-    std::vector<cNodeID> smoothPath;
-    for ( auto it = waypointIDs.begin() + 1; it != waypointIDs.end(); ++it )
-    {
-        cNodeID actual { static_cast<int>(*(it-1)), static_cast<int>(*it) };
-        if ( redrawn.find(actual) != redrawn.end() ) // if this was redrawn
+        std::reverse(path.begin(), path.end());
+        
+        for ( auto tmp = meet; ws.mParentB[tmp] != tmp; )
         {
-            for ( auto& j : redrawn[actual] )
-                smoothPath.push_back(j);
-        } else                                  // we just use the original if it wasn't redrawn
-            for ( auto k = actual.x; k <= actual.y; ++k )
-                smoothPath.push_back(path[k]);
+            tmp = ws.mParentB[tmp];
+            path.push_back(K::node(mBoard, tmp));
+        }
     }
     
-    return smoothPath;
+    forward.clear();
+    backward.clear();
 }
 
-nodevec cPathFinder::neighbours(const cNodeID& current,
-                                const cNodeID& start,
-                                const cNodeID& end,
-                                bool corcuta,
-                                bool jps)
+template <typename K, typename Q>
+void cPathFinder::searchSlice(cSearchHandle& handle,
+                              Q& open,
+                              unsigned long expansions,
+                              double micros) const
 {
+    // search(), a budget at a time. The open list and everything else
+    // stays in the handle's workspace between steps, and the search goes
+    // on from there. The clock is read every 16 expansions, which keeps
+    // a step within a few microseconds of its time on big boards, where
+    // an expansion can take one.
 
-    // This is the rub. Jump point search differs from basic A* in the way it finds the
-    // neighbours of any given node. For JPS, a neighbour need not be immediately adjacent
-    // to the node we're considering.
-    
-    return jps ? successors(current, start, end, corcuta) : adjacent(current, corcuta);
-}
+    auto&                   ws = *handle.mWorkspace;
+    auto&                   path = ws.mPath;
+    auto&                   next = ws.mNeighbours;
+    const auto&             start = handle.mStart;
+    const auto&             end = handle.mGoal;
+    cStatTimer              searching { ws.mStats.searchMicros };
+    auto                    began = std::chrono::steady_clock::now();
 
-std::vector<cNodeID> cPathFinder::findPath(const cNodeID& start,
-                                          const cNodeID& end,
-                                          bool corCutAllowed,
-                                          bool smooth)
-{
-    std::vector<cNodeID>    path;
-    std::vector<cNodeID>    found;
-    cNodeID                 currentNode { start };
-    
-    addToOpenList(currentNode, currentNode, end);
-    
-    // "q:" the priority queue of nodes on the open list
-    
-    while ( !onCList(end) && !q.empty() )
+    if ( handle.mFresh )
     {
-        currentNode = q.pop_and_get().id;
-        addToClosedList(currentNode);
-        found.push_back(currentNode);
-        
-        for (auto& i : neighbours(currentNode, start, end, corCutAllowed, mJPS))
-            if ( !onCList(i) )
+        addToOpenList<K>(ws, open, start, start, end);
+        handle.mBest = K::index(mBoard, start.x, start.y);
+        handle.mBestH = calcHscore<K>(start, end);
+        handle.mFresh = false;
+    }
+
+    for ( unsigned long n = 0; !onCList<K>(ws, end) && !open.empty(); ++n )
+    {
+        if ( n > 0 &&
+             ((expansions && n >= expansions) ||
+              (micros > 0 && n % 16 == 0 &&
+               std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - began).count() >= micros)) )
+            break;
+
+        auto i = open.pop_and_get();
+        auto currentNode = K::node(mBoard, i);
+        addToClosedList<K>(ws, currentNode);
+        SEARCH_STAT(++ws.mStats.expanded);
+
+        auto estimate = calcHscore<K>(currentNode, end);
+        if ( estimate < handle.mBestH ||
+             (estimate == handle.mBestH && ws.mGscore[i] < ws.mGscore[handle.mBest]) )
+        {
+            handle.mBest = i;
+            handle.mBestH = estimate;
+        }
+
+        neighbours<K>(ws, currentNode, start, end, next);
+        for ( auto& n : next )
+            if ( !onCList<K>(ws, n) )
             {
-                if ( !onOList(i) )
-                {
-                    addToOpenList(i, currentNode, end);
-                }
-                else
-                {
-                    if ( calcGscore(currentNode, i) < mBoard[i.x][i.y].gScore )
-                    {
-                         updateOpenList(i, currentNode);
-                    }
-                }
+                if ( !onOList<K>(ws, n) )
+                    addToOpenList<K>(ws, open, n, currentNode, end);
+                else if ( calcGscore<K>(ws, currentNode, n) < ws.mGscore[K::index(mBoard, n.x, n.y)] )
+                    updateOpenList<K>(ws, open, n, currentNode, end);
             }
     }
-    
-    if ( onCList(end) ) // path found!
+
+    searching.stop();
+    cStatTimer reconstructing { ws.mStats.reconstructMicros };
+
+    bool found = onCList<K>(ws, end);
+    if ( found || open.empty() )
+    {
+        handle.mState = found ? cSearchState::found : cSearchState::noPath;
+        open.clear();
+    }
+
+    path.clear();
+    if ( found || (handle.mState == cSearchState::running && handle.mPartial) )
     {
-        cNodeID tmp = end;
-        while ( mBoard[tmp.x][tmp.y].parent != tmp )
+        for ( auto i = found ? K::index(mBoard, end.x, end.y) : handle.mBest; ; i = ws.mParent[i] )
         {
-            path.insert(path.begin(), tmp);
-            tmp = mBoard[tmp.x][tmp.y].parent;
+            path.push_back(K::node(mBoard, i));
+            if ( ws.mParent[i] == i ) break;
         }
-        path.insert(path.begin(), tmp);
+        std::reverse(path.begin(), path.end());
     }
+}
+
+template <typename S>
+void cPathFinder::searchWith(cWorkspace& ws,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             bool corCutAllowed,
+                             bool useJumpTable) const
+{
+    typedef cAnyAngleScoring<S> T;
+    if ( mThetaStar && mLazyTheta )
+        return corCutAllowed ? searchSized<T, cEngine::lazyTheta, true>(ws, start, end) :
+                               searchSized<T, cEngine::lazyTheta, false>(ws, start, end);
+    if ( mThetaStar )
+        return corCutAllowed ? searchSized<T, cEngine::theta, true>(ws, start, end) :
+                               searchSized<T, cEngine::theta, false>(ws, start, end);
+    if ( !mJPS )
+        return corCutAllowed ? searchSized<S, cEngine::aStar, true>(ws, start, end) :
+                               searchSized<S, cEngine::aStar, false>(ws, start, end);
+    if ( useJumpTable )
+        return corCutAllowed ? searchSized<S, cEngine::jpsPlus, true>(ws, start, end) :
+                               searchSized<S, cEngine::jpsPlus, false>(ws, start, end);
+    return corCutAllowed ? searchSized<S, cEngine::jps, true>(ws, start, end) :
+                           searchSized<S, cEngine::jps, false>(ws, start, end);
+}
+
+template <typename S, cEngine E, bool CC>
+void cPathFinder::searchSized(cWorkspace& ws,
+                              const cNodeID& start,
+                              const cNodeID& end) const
+{
+#if PATHFINDER_FIXED_WIDTH > 0 && PATHFINDER_FIXED_HEIGHT > 0
+    if ( width() == PATHFINDER_FIXED_WIDTH && height() == PATHFINDER_FIXED_HEIGHT )
+        return searchOn<cKernel<S, E, CC, PATHFINDER_FIXED_WIDTH, PATHFINDER_FIXED_HEIGHT>>(ws, start, end);
+#endif
+    return searchOn<cKernel<S, E, CC>>(ws, start, end);
+}
+
+template <typename K>
+void cPathFinder::searchOn(cWorkspace& ws,
+                           const cNodeID& start,
+                           const cNodeID& end) const
+{
+    if ( K::anyAngle )
+        return mOpenList == cOpenList::buckets ? searchAnyAngle<K>(ws, ws.mBuckets, start, end) :
+                                                 searchAnyAngle<K>(ws, ws.mHeap, start, end);
     
-    while ( !q.empty() )    // Flush the open list; very important to do
-        q.pop();            // after each pathfinding!
-    
-    ++UID;                  // also very important: next pathfinding:
-                            // new unique ID.
+    if ( mSuboptimal == cSuboptimal::focal ) return searchFocal<K>(ws, start, end);
+
+    if ( mSuboptimal != cSuboptimal::off )
+        return mOpenList == cOpenList::buckets ? searchAnytime<K>(ws, ws.mBuckets, start, end) :
+                                                 searchAnytime<K>(ws, ws.mHeap, start, end);
 
-    return smooth == false ? path : smoothPath(path);
+    // Jump points from both ends only meet on shortest paths with corner
+    // cutting; without it, both sides run A*.
+    typedef typename std::conditional<K::jps && !K::cornerCutting, typename K::aStar, K>::type B;
+    if ( mBidirectional )
+        return mOpenList == cOpenList::buckets ? searchBoth<B>(ws, ws.mBuckets, ws.mBucketsB, start, end) :
+                                                 searchBoth<B>(ws, ws.mHeap, ws.mHeapB, start, end);
+    
+    return mOpenList == cOpenList::buckets ? search<K>(ws, ws.mBuckets, start, end) :
+                                             search<K>(ws, ws.mHeap, start, end);
 }
 
-void cPathFinder::setView(const sf::View& v)
+template <typename S>
+void cPathFinder::stepWith(cSearchHandle& handle, unsigned long expansions, double micros) const
 {
-    mVs = v.getSize();
-    mVc = v.getCenter();
+    bool cc = handle.mCornerCutting;
+    if ( !handle.mJPS )
+        return cc ? stepOn<cKernel<S, cEngine::aStar, true>>(handle, expansions, micros) :
+                    stepOn<cKernel<S, cEngine::aStar, false>>(handle, expansions, micros);
+    if ( handle.mUseJumpTable )
+        return cc ? stepOn<cKernel<S, cEngine::jpsPlus, true>>(handle, expansions, micros) :
+                    stepOn<cKernel<S, cEngine::jpsPlus, false>>(handle, expansions, micros);
+    return cc ? stepOn<cKernel<S, cEngine::jps, true>>(handle, expansions, micros) :
+                stepOn<cKernel<S, cEngine::jps, false>>(handle, expansions, micros);
 }
 
-void cPathFinder::startMarking(const sf::Vector2i& pos)
+template <typename K>
+void cPathFinder::stepOn(cSearchHandle& handle, unsigned long expansions, double micros) const
 {
-    mMarkerStart.x = (mVc.x - (mVs.x / 2 ) + pos.x) / mTileSize.x;
-    mMarkerStart.y = (mVc.y - (mVs.y / 2 ) + pos.y) / mTileSize.y;
-    if ( mMarkerStart.x >= mBoardSize.x ) mMarkerStart.x = mBoardSize.x-1;
-    if ( mMarkerStart.y >= mBoardSize.y ) mMarkerStart.y = mBoardSize.y-1;
+    auto& ws = *handle.mWorkspace;
+    return handle.mOpenList == cOpenList::buckets ? searchSlice<K>(handle, ws.mBuckets, expansions, micros) :
+                                                    searchSlice<K>(handle, ws.mHeap, expansions, micros);
 }
 
-void cPathFinder::keepMarking(const sf::Vector2i& pos)
+std::vector<cNodeID> cPathFinder::findPath(const cNodeID& start,
+                                          const cNodeID& end,
+                                          bool corCutAllowed,
+                                          bool smooth)
 {
-    mMarkerNow.x = (mVc.x - (mVs.x / 2 ) + pos.x) / mTileSize.x;
-    mMarkerNow.y = (mVc.y - (mVs.y / 2 ) + pos.y) / mTileSize.y;
-    
-    if ( mMarkerNow.x >= mBoardSize.x ) mMarkerNow.x = mBoardSize.x-1;
-    if ( mMarkerNow.y >= mBoardSize.y ) mMarkerNow.y = mBoardSize.y-1;
-    
-    short int       stepx { 0 };
-    short int       stepy { 0 };
+    mBoard.trim();
+    if ( mPathTree ) buildPathTree(start, corCutAllowed);
+    else if ( mHPA ) buildHierarchy(corCutAllowed);
+    else if ( mJPS && mJPSPlus ) buildJumpTable(corCutAllowed);
+    if ( mRejectUnreachable ) buildComponents(corCutAllowed);
+    
+    if ( !mCachePaths || mSuboptimal != cSuboptimal::off )
+        return findPath(mWorkspace, start, end, corCutAllowed, smooth);
+    
+    bool usesHeuristic = !mPathTree && !mHPA;
+    cPathCache::cKey key { start, end, corCutAllowed, smooth, engine(), usesHeuristic ? mHeuristic : cHeuristic::octile,
+                           mBidirectional && usesHeuristic, usesHeuristic ? mOpenList : cOpenList::binaryHeap };
+    if ( auto cached = mCache.find(key) )
+    {
+        SEARCH_STAT(mWorkspace.mStats = cSearchStats { });
+        return *cached;
+    }
     
-    if (mMarkerNow.x > mMarkerStart.x) stepx = 1;
-    if (mMarkerNow.x < mMarkerStart.x) stepx = -1;
+    auto path = findPath(mWorkspace, start, end, corCutAllowed, smooth);
+    mCache.insert(key, path);
+    return path;
+}
 
-    if (mMarkerNow.y > mMarkerStart.y ) stepy = 1;
-    if (mMarkerNow.y < mMarkerStart.y ) stepy = -1;
+cEngine cPathFinder::engine() const
+{
+    if ( mPathTree ) return cEngine::pathTree;
+    if ( mHPA ) return cEngine::hpa;
+    if ( mThetaStar ) return mLazyTheta ? cEngine::lazyTheta : cEngine::theta;
+    if ( mJPS ) return mJPSPlus ? cEngine::jpsPlus : cEngine::jps;
+    return cEngine::aStar;
+}
 
-    if (mMarkerNow.x == mMarkerStart.x && mMarkerNow.y == mMarkerStart.y)
+std::vector<cNodeID> cPathFinder::findPath(cWorkspace& ws,
+                                          const cNodeID& start,
+                                          const cNodeID& end,
+                                          bool corCutAllowed,
+                                          bool smooth) const
+{
+    nodevec path;
+    findPath(ws, start, end, path, corCutAllowed, smooth);
+    return path;
+}
+
+void cPathFinder::findPath(cWorkspace& ws,
+                           const cNodeID& start,
+                           const cNodeID& end,
+                           nodevec& path,
+                           bool corCutAllowed,
+                           bool smooth) const
+{
+    bool anyAngle = searchFor(ws, start, end, corCutAllowed);
+    if ( smooth == false )
     {
-        mBoard[mMarkerNow.x][mMarkerNow.y].marked = true;
+        path.assign(ws.mPath.begin(), ws.mPath.end());
         return;
     }
     
-    auto i = mMarkerStart.x;
+    cStatTimer smoothing { ws.mStats.smoothMicros };
+    if ( anyAngle ) return drawPath(ws.mPath, path);
+    smoothPath(ws.mStats, ws.mPath, corCutAllowed, ws.mWaypoints);
+    drawPath(ws.mWaypoints, path);
+}
 
-    do
-    {
-        auto j = mMarkerStart.y;
-        do
-        {
-            mBoard[i][j].marked = true;
-            j += stepy;
-        } while (j != mMarkerNow.y + stepy);
-        i += stepx;
-    } while ( i != mMarkerNow.x + stepx );
+unsigned int cPathFinder::findPath(cWorkspace& ws,
+                                   cPathArena& arena,
+                                   const cNodeID& start,
+                                   const cNodeID& end,
+                                   bool corCutAllowed,
+                                   bool smooth) const
+{
+    bool anyAngle = searchFor(ws, start, end, corCutAllowed);
+    if ( smooth == false || anyAngle ) return arena.add(ws.mPath);
     
+    {
+        cStatTimer smoothing { ws.mStats.smoothMicros };
+        smoothPath(ws.mStats, ws.mPath, corCutAllowed, ws.mWaypoints);
+    }
+    return arena.add(ws.mWaypoints);
 }
 
-void cPathFinder::toggleMarkedOnes()
+bool cPathFinder::searchFor(cWorkspace& ws,
+                            const cNodeID& start,
+                            const cNodeID& end,
+                            bool corCutAllowed) const
 {
-    short int       stepx { 0 };
-    short int       stepy { 0 };
+    if ( ws.size() != mBoard.size() )
+        throw std::runtime_error("Workspace is for a different board.");
+    
+    // Weighted keys go up to g + w * h; see checkScores().
+    if ( mSuboptimal != cSuboptimal::off && !(mWeight >= 1) )
+        throw std::runtime_error("Weight must be at least 1.");
+    if ( mSuboptimal != cSuboptimal::off && (1 + mWeight) * maxCost(mBoard) >= ~0u )
+        throw std::runtime_error("Weight too big for this board.");
+
+    SEARCH_STAT(ws.mStats = cSearchStats { });
+    ws.mBound = 0;
+    ws.mPath.clear();
+    if ( blocked(start.x, start.y) || blocked(end.x, end.y) ) return false;
+    if ( !reachable(start, end, corCutAllowed) ) return false;
+    
+    if ( mBidirectional && ws.mGscoreB.size() != ws.size() )
+    {
+        ws.mGscoreB.resize(ws.size());
+        ws.mParentB.resize(ws.size());
+        ws.mWhichListB.assign(ws.size(), 0);
+        ws.mHeapB.resize(ws.size());
+        ws.mBucketsB.resize(ws.size());
+    }
     
-    if (mMarkerNow.x > mMarkerStart.x) stepx = 1;
-    if (mMarkerNow.x < mMarkerStart.x) stepx = -1;
+    if ( mSuboptimal == cSuboptimal::focal && ws.mFocal.cells() != ws.size() )
+    {
+        ws.mFocal.resize(ws.size());
+        ws.mWaiting.resize(ws.size());
+    }
+
+    bool useJumpTable = mJPSPlus && mJumpTable.built() && mJumpTable.cornerCutting() == corCutAllowed;
     
-    if (mMarkerNow.y > mMarkerStart.y ) stepy = 1;
-    if (mMarkerNow.y < mMarkerStart.y ) stepy = -1;
+    bool hpa = mHPA && mHierarchy.built() && mHierarchy.cornerCutting() == corCutAllowed;
     
-    auto i = mMarkerStart.x;
+    bool tree = mPathTree && mTree.built() && mTree.source() == start && mTree.cornerCutting() == corCutAllowed;
     
-    do
+    // The search leaves its path in ws.mPath; assign() rather than "=" for
+    // the others, so that the buffer keeps its capacity.
+    try
     {
-        auto j = mMarkerStart.y;
-        do
-        {
-            if (mBoard[i][j].status == cStatus::blocked)
-                mBoard[i][j].status = cStatus::walkable;
-            else mBoard[i][j].status = cStatus::blocked;
-            j += stepy;
-        } while (j != mMarkerNow.y + stepy);
-        i += stepx;
-    } while ( i != mMarkerNow.x + stepx );
+        dispatch(ws, start, end, corCutAllowed, useJumpTable, tree, hpa);
+    }
+    catch ( ... )
+    {
+        // A chunk loader threw (see cBoard). Leave the workspace as a
+        // finished search would, for the next query.
+        ws.mHeap.clear();
+        ws.mBuckets.clear();
+        ws.mHeapB.clear();
+        ws.mBucketsB.clear();
+        ws.mFocal.clear();
+        ws.mWaiting.clear();
+        ws.mPath.clear();
+        ++ws.UID;
+        throw;
+    }
+
+    ++ws.UID;               // very important: next pathfinding:
+                            // new unique ID.
+
+    return mThetaStar && !tree && !hpa;
 }
 
-bool cPathFinder::walk(const sf::Vector2i& from,
-                       const sf::Vector2i& to,
-                       bool cornercutting,
-                       bool smoothing)
+void cPathFinder::dispatch(cWorkspace& ws,
+                           const cNodeID& start,
+                           const cNodeID& end,
+                           bool corCutAllowed,
+                           bool useJumpTable,
+                           bool tree,
+                           bool hpa) const
 {
-    if ( to.x > mBoardSize.x * mTileSize.x ||
-         to.y > mBoardSize.y * mTileSize.y ) return false;
-    
-    sf::Vector2i    sTile, eTile;
-    
-    sTile.x = (mVc.x - (mVs.x / 2 ) + from.x ) / mTileSize.x;
-    sTile.y = (mVc.y - (mVs.y / 2 ) + from.y ) / mTileSize.y;
-    
-    eTile.x = (mVc.x - (mVs.x / 2 ) + to.x ) / mTileSize.x;
-    eTile.y = (mVc.y - (mVs.y / 2 ) + to.y ) / mTileSize.y;
-    
-    if ( !valid(eTile.x, eTile.y) ) return false;
+    if ( tree )
+    {
+        cStatTimer reconstruction { ws.mStats.reconstructMicros };
+        auto found = mTree.pathTo(mBoard, end);
+        ws.mPath.assign(found.begin(), found.end());
+    }
+    else if ( hpa )
+    {
+        auto found = mHierarchy.findPath(mBoard, ws, start, end);
+        ws.mPath.assign(found.begin(), found.end());
+    }
+    else switch ( mHeuristic )
+    {
+        case cHeuristic::octile:    searchWith<cOctileScoring>(ws, start, end, corCutAllowed, useJumpTable); break;
+        case cHeuristic::euclidean: searchWith<cEuclideanScoring>(ws, start, end, corCutAllowed, useJumpTable); break;
+        case cHeuristic::chebyshev: searchWith<cChebyshevScoring>(ws, start, end, corCutAllowed, useJumpTable); break;
+        case cHeuristic::manhattan: searchWith<cManhattanScoring>(ws, start, end, corCutAllowed, useJumpTable); break;
+    }
+}
+
+std::vector<cNodeID> cPathFinder::findPath(cReplanner& r,
+                                          const cNodeID& start,
+                                          const cNodeID& goal,
+                                          bool corCutAllowed,
+                                          bool smooth) const
+{
+    SEARCH_STAT(r.mStats = cSearchStats { });
+    if ( blocked(start.x, start.y) || blocked(goal.x, goal.y) ) return nodevec { };
+    if ( !reachable(start, goal, corCutAllowed) ) return nodevec { };
     
-    if ( mBoard[sTile.x][sTile.y].status == cStatus::blocked ||
-         mBoard[eTile.x][eTile.y].status == cStatus::blocked) return false;
+    // Can it catch up on the edits it hasn't seen?
+    bool current = r.mVersion == mVersion ||
+                   (!mEdits.empty() && mEdits.front().version <= r.mVersion + 1);
     
-    std::vector<cNodeID> path = findPath(cNodeID { sTile.x, sTile.y },
-                                         cNodeID { eTile.x, eTile.y },
-                                         cornercutting,
-                                         smoothing);
+    if ( !r.mPlanned || !current || r.mGoal != goal || r.mCornerCutting != corCutAllowed ||
+         r.mG.size() != mBoard.size() )
+        r.plan(mBoard, start, goal, corCutAllowed, mVersion);
+    else
+    {
+        r.moveTo(start);
+        for ( auto& e : mEdits )
+            if ( e.version > r.mVersion ) r.edited(mBoard, e.a, e.b);
+        r.mVersion = mVersion;
+    }
     
-    if ( path.empty() ) return false;
+    auto path = r.path(mBoard);
+    if ( smooth == false ) return path;
     
-    for(auto&& i : path)
-        mBoard[i.x][i.y].status = cStatus::walked;
+    cStatTimer smoothing { r.mStats.smoothMicros };
+    nodevec waypoints, tiles;
+    smoothPath(r.mStats, path, corCutAllowed, waypoints);
+    drawPath(waypoints, tiles);
+    return tiles;
+}
+
+void cPathFinder::beginSearch(cSearchHandle& handle,
+                              const cNodeID& start,
+                              const cNodeID& goal,
+                              bool corCutAllowed,
+                              bool smooth,
+                              bool partial) const
+{
+    if ( !handle.mWorkspace || handle.mWorkspace->size() != mBoard.size() )
+        handle.mWorkspace.reset(new cWorkspace { mBoard.size() });
 
-    return true;
+    handle.mStart = start;
+    handle.mGoal = goal;
+    handle.mCornerCutting = corCutAllowed;
+    handle.mSmooth = smooth;
+    handle.mPartial = partial;
+    handle.mHeuristic = mHeuristic;
+    handle.mOpenList = mOpenList;
+    handle.mJPS = mJPS;
+    handle.mJPSPlus = mJPSPlus;
+
+    SEARCH_STAT(handle.mWorkspace->mStats = cSearchStats { });
+    restart(handle);
+    handle.mRestarts = 0;
 }
 
-// Attention. What we have here are screen coordinates!
-void cPathFinder::toggle(const sf::Vector2i& pos)
+void cPathFinder::restart(cSearchHandle& handle) const
 {
-    sf::Vector2i    tile;
-    tile.x = (mVc.x - (mVs.x / 2) + pos.x) / mTileSize.x;
-    tile.y = (mVc.y - (mVs.y / 2) + pos.y) / mTileSize.y;
-    
-    if ( tile.x < 0 || tile.x >= mBoardSize.x ) return;
-    if ( tile.y < 0 || tile.y >= mBoardSize.y ) return;
-    
-    if ( mBoard[tile.x][tile.y].status == cStatus::blocked )
-        mBoard[tile.x][tile.y].status = cStatus::walkable;
+    auto& ws = *handle.mWorkspace;
+    ws.mHeap.clear();
+    ws.mBuckets.clear();
+    ws.mPath.clear();
+    ++ws.UID;
+
+    handle.mPath.clear();
+    handle.mStats = ws.mStats;
+    handle.mVersion = mVersion;
+    ++handle.mRestarts;
+    handle.mUseJumpTable = handle.mJPS && handle.mJPSPlus && mJumpTable.built() &&
+                           mJumpTable.cornerCutting() == handle.mCornerCutting;
+    handle.mFresh = true;
+
+    auto& start = handle.mStart;
+    auto& goal = handle.mGoal;
+    if ( blocked(start.x, start.y) || blocked(goal.x, goal.y) || !reachable(start, goal, handle.mCornerCutting) )
+        handle.mState = cSearchState::noPath;
     else
-        mBoard[tile.x][tile.y].status = cStatus::blocked;
+        handle.mState = cSearchState::running;
 }
 
-void cPathFinder::toggle(unsigned long int x,
-                         unsigned long int y)
+cSearchState cPathFinder::step(cSearchHandle& handle, unsigned long expansions, double micros) const
 {
-    sf::Vector2i    tile;
-    tile.x = (mVc.x - (mVs.x / 2) + x) / mTileSize.x;
-    tile.y = (mVc.y - (mVs.y / 2) + y) / mTileSize.y;
-    
-    if ( tile.x < 0 || tile.x >= mBoardSize.x ) return;
-    if ( tile.y < 0 || tile.y >= mBoardSize.y ) return;
-    
-    if ( mBoard[tile.x][tile.y].status == cStatus::blocked )
-        mBoard[tile.x][tile.y].status = cStatus::walkable;
+    if ( handle.mState == cSearchState::idle || handle.mState == cSearchState::cancelled ) return handle.mState;
+
+    // An edit since the search began, or a JPS+ table that has come or
+    // gone, starts it over.
+    bool useJumpTable = handle.mJPS && handle.mJPSPlus && mJumpTable.built() &&
+                        mJumpTable.cornerCutting() == handle.mCornerCutting;
+    if ( handle.mVersion != mVersion || handle.mUseJumpTable != useJumpTable ) restart(handle);
+    if ( handle.mState != cSearchState::running ) return handle.mState;
+
+    auto& ws = *handle.mWorkspace;
+    try
+    {
+        switch ( handle.mHeuristic )
+        {
+            case cHeuristic::octile:    stepWith<cOctileScoring>(handle, expansions, micros); break;
+            case cHeuristic::euclidean: stepWith<cEuclideanScoring>(handle, expansions, micros); break;
+            case cHeuristic::chebyshev: stepWith<cChebyshevScoring>(handle, expansions, micros); break;
+            case cHeuristic::manhattan: stepWith<cManhattanScoring>(handle, expansions, micros); break;
+        }
+    }
+    catch ( ... )
+    {
+        // A chunk loader threw (see cBoard).
+        ws.mHeap.clear();
+        ws.mBuckets.clear();
+        ws.mPath.clear();
+        ++ws.UID;
+        handle.cancel();
+        handle.mStats = ws.mStats;
+        throw;
+    }
+
+    if ( !handle.mSmooth )
+        handle.mPath.assign(ws.mPath.begin(), ws.mPath.end());
     else
-        mBoard[tile.x][tile.y].status = cStatus::blocked;
+    {
+        cStatTimer smoothing { ws.mStats.smoothMicros };
+        smoothPath(ws.mStats, ws.mPath, handle.mCornerCutting, ws.mWaypoints);
+        drawPath(ws.mWaypoints, handle.mPath);
+    }
+
+    handle.mStats = ws.mStats;
+    return handle.mState;
 }
 
-void cPathFinder::render(sf::RenderWindow& w)
+bool cPathFinder::reachable(const cNodeID& start, const cNodeID& end, bool corCutAllowed) const
 {
-    
-    sf::Vector2i startTile;
-    startTile.x = (mVc.x - (mVs.x / 2)) / mTileSize.x;
-    startTile.y = (mVc.y - (mVs.y / 2)) / mTileSize.y;
-    
-    sf::Vector2u tileCount;
-    tileCount.x = (mVs.x / mTileSize.x) + startTile.x + 2;
-    tileCount.y = (mVs.y / mTileSize.y) + startTile.y + 2;
-    
-    if (tileCount.x > mBoardSize.x ) tileCount.x = mBoardSize.x;
-    if (tileCount.y > mBoardSize.y ) tileCount.y = mBoardSize.y;
-    
-    sf::Color       tmpCol;
-    sf::Color       outCol;
-    
-    auto row = tileCount.x - startTile.x;       // this many tiles in a single row
-    
-    for(auto i = startTile.y; i < tileCount.y; ++i)
-        for(auto j = startTile.x; j < tileCount.x; ++j)
+    if ( !mRejectUnreachable || !mComponents.built() || mComponents.cornerCutting() != corCutAllowed )
+        return true;
+    return mComponents.connected(mBoard, start, end);
+}
+
+cThreadPool& cPathFinder::pool()
+{
+    if ( !mPool )
+    {
+        mPool.reset(new cThreadPool);
+        mWorkerSpaces.resize(mPool->size());
+    }
+    return *mPool;
+}
+
+cWorkspace& cPathFinder::workerSpace()
+{
+    // Only ever called on a pool thread, and every thread has a slot of
+    // its own, so there's nothing to lock here.
+    auto& ws = mWorkerSpaces[mPool->workerIndex()];
+    if ( !ws ) ws.reset(new cWorkspace { mBoard.size() });
+    return *ws;
+}
+
+std::vector<nodevec> cPathFinder::findPaths(const std::vector<cQuery>& queries,
+                                            bool corCutAllowed,
+                                            bool smooth,
+                                            std::vector<cSearchStats>* stats)
+{
+    std::vector<nodevec> paths(queries.size());
+    if ( stats ) stats->assign(queries.size(), cSearchStats { });
+    if ( queries.empty() ) return paths;
+    
+    // Before anything runs in parallel: these write the board's tables.
+    mBoard.trim();
+    if ( mHPA ) buildHierarchy(corCutAllowed);
+    else if ( mJPS && mJPSPlus ) buildJumpTable(corCutAllowed);
+    if ( mRejectUnreachable ) buildComponents(corCutAllowed);
+    
+    auto& p = pool();
+    
+    // A few chunks per thread, so that stealing can even out the
+    // differences between long and short queries.
+    size_t chunk = std::max<size_t>(1, queries.size() / (p.size() * 8));
+    size_t chunks = (queries.size() + chunk - 1) / chunk;
+    
+    std::atomic<size_t>     left { chunks };
+    std::promise<void>      done;
+    std::mutex              failureLock;
+    std::exception_ptr      failure;
+    
+    for ( size_t c = 0; c < chunks; ++c )
+        p.submit([&, c]()
         {
-            
-            switch (mBoard[j][i].status) {
-                case cStatus::walkable:
-                {
-                    tmpCol = sf::Color::White;
-                    break;
-                }
-                case cStatus::blocked:
+            auto& ws = workerSpace();
+            auto last = std::min(queries.size(), (c + 1) * chunk);
+            for ( auto i = c * chunk; i < last; ++i )
+            {
+                try
                 {
-                    tmpCol = sf::Color::Blue;
-                    break;
+                    paths[i] = findPath(ws, queries[i].start, queries[i].goal, corCutAllowed, smooth);
                 }
-                case cStatus::walked:
+                catch ( ... )
                 {
-                    tmpCol = sf::Color::Red;
-                    mBoard[j][i].status = cStatus::walkable;
-                    break;
+                    std::lock_guard<std::mutex> lock { failureLock };
+                    if ( !failure ) failure = std::current_exception();
                 }
+                if ( stats ) (*stats)[i] = ws.stats();
             }
             
-            // "Marked" boolean flags are automatically reset
-            // in each rendering turn.
-            
-            if (mBoard[j][i].marked)
-            {
-                tmpCol.a = 120;
-                outCol = sf::Color::Cyan;
-                mBoard[j][i].marked = false;
-            } else outCol = sf::Color::Black;
-            
-            auto id = (4 * row) * i + ( 4 * j );
-            
-            mGrid[id].color = tmpCol;
-            mGrid[id+1].color = tmpCol;
-            mGrid[id+2].color = tmpCol;
-            mGrid[id+3].color = tmpCol;
+            if ( --left == 0 ) done.set_value();
+        });
+    
+    done.get_future().wait();
+    if ( failure ) std::rethrow_exception(failure);
+    return paths;
+}
+
+std::future<nodevec> cPathFinder::findPathAsync(const cNodeID& start,
+                                                const cNodeID& end,
+                                                bool corCutAllowed,
+                                                bool smooth)
+{
+    // std::function needs a copyable callable, hence the shared_ptr.
+    auto promise = std::make_shared<std::promise<nodevec>>();
+    auto result = promise->get_future();
+    
+    pool().submit([this, start, end, corCutAllowed, smooth, promise]()
+    {
+        try
+        {
+            promise->set_value(findPath(workerSpace(), start, end, corCutAllowed, smooth));
         }
+        catch ( ... )
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    
+    return result;
+}
 
-    w.draw(&mGrid[0], mGrid.size(), sf::Quads);     // vertexarray, yay!
-}
\ No newline at end of file
+void cPathFinder::findPathAsync(const cNodeID& start,
+                                const cNodeID& end,
+                                bool corCutAllowed,
+                                bool smooth,
+                                std::function<void(nodevec)> done)
+{
+    // The JPS+ table and the hierarchy aren't built from here: other
+    // queries may be running. Build them up front to have them used.
+    pool().submit([this, start, end, corCutAllowed, smooth, done]()
+    {
+        done(findPath(workerSpace(), start, end, corCutAllowed, smooth));
+    });
+}
+
+void cPathFinder::edited(const cNodeID& a, const cNodeID& b)
+{
+    mJumpTable.update(mBoard, a, b);
+    mHierarchy.update(mBoard, a, b);
+    mTree.update(mBoard, a, b);
+    mComponents.update(mBoard, a, b);
+    mCache.edited(a, b);
+    
+    mEdits.push_back(cEdit { ++mVersion, a, b });
+    if ( mEdits.size() > editLogSize ) mEdits.pop_front();
+}
+
+void cPathFinder::setBlocked(unsigned int x,
+                             unsigned int y,
+                             bool b)
+{
+    mBoard.setBlocked(x, y, b);
+    edited(cNodeID(x, y), cNodeID(x, y));
+}
+
+void cPathFinder::toggle(unsigned int x,
+                         unsigned int y)
+{
+    mBoard.toggle(x, y);
+    edited(cNodeID(x, y), cNodeID(x, y));
+}
+
+void cPathFinder::toggleArea(const cNodeID& a, const cNodeID& b)
+{
+    mBoard.toggleArea(a, b);
+    edited(a, b);
+}
@@ -1,105 +1,487 @@
 #ifndef __small_astartest__pathfinder__
 #define __small_astartest__pathfinder__
 
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
 #include "nodeID.h"
 #include "board.h"
-#include "prQueue.h"
-#include "listElement.h"
-#include <SFML/Graphics.hpp>
+#include "components.h"
+#include "enums.h"
+#include "jumpTable.h"
+#include "hierarchy.h"
+#include "pathArena.h"
+#include "pathCache.h"
+#include "pathTree.h"
+#include "replanner.h"
+#include "scoring.h"
+#include "searchHandle.h"
+#include "searchKernel.h"
+#include "threadPool.h"
+#include "workspace.h"
+
+class cSnapshot;
 
 typedef std::vector<cNodeID> nodevec;
 
-struct twoints {
-    int x, y;
-    bool ok;
+struct cQuery {
+    cNodeID     start;
+    cNodeID     goal;
 };
 
+// The pathfinder itself knows nothing about windows, views or pixels:
+// everything here is in tile coordinates, (0, 0) being the top left
+// tile of the board. Rendering and mouse handling live in cBoardView.
+//
+// Searching only reads the board; whatever a search writes goes into a
+// cWorkspace. So the const findPath() can be called from any number of
+// threads at once, each with its own workspace, and findPaths() and
+// findPathAsync() do just that on a thread pool. The one rule: don't edit
+// the board (or build the JPS+ table or the hierarchy) while searches
+// are running.
+
 class cPathFinder {
 public:
     cPathFinder(unsigned int, unsigned int);
     
-    void        render(sf::RenderWindow&);
+    // On a paged board (see cBoard), loaded a chunk at a time as searches
+    // get there. The plain findPath() and findPaths() trim it back to the
+    // budget before they search; with the workspace overloads, call
+    // trim() between queries.
+    cPathFinder(unsigned int, unsigned int, cChunkLoader, size_t budget);
 
-    void        toggle(const sf::Vector2i&);
-    void        toggle(unsigned long int, unsigned long int);
+    // Over a snapshot (see snapshot.h): the board, and whatever tables it
+    // has, read straight from the mapped file, which is kept open for as
+    // long as the pathfinder lives.
+    explicit cPathFinder(std::shared_ptr<const cSnapshot>);
+
+    unsigned int    width() const { return mBoard.width(); }
+    unsigned int    height() const { return mBoard.height(); }
+    const cBoard&   board() const { return mBoard; }
+    
+    bool            valid(long int x, long int y) const { return mBoard.valid(x, y); }
+    bool            blocked(long int x, long int y) const { return mBoard.blocked(x, y); }
     
-    void        startMarking(const sf::Vector2i&);
-    void        keepMarking(const sf::Vector2i&);
+    void            setBlocked(unsigned int x, unsigned int y, bool b);
+    void            toggle(unsigned int x, unsigned int y);
     
-    void        toggleMarkedOnes();
-    void        setView(const sf::View&);
+    // Toggles every tile in the rectangle spanned by the two corners;
+    // the corners may be given in any order.
+    void            toggleArea(const cNodeID&, const cNodeID&);
 
-    nodevec     findPath(const cNodeID& start,
-                         const cNodeID& end,
-                         bool corCutAllowed = false,
-                         bool smooth = true);
+    // Drops board chunks over the budget of a paged board. Like an edit,
+    // not while searches are running.
+    void            trim() { mBoard.trim(); }
+
+    // Builds the JPS+ table up front, rather than on the first query.
+    void            buildJumpTable(bool corCutAllowed);
+    
+    // Likewise for the HPA* hierarchy.
+    void            buildHierarchy(bool corCutAllowed);
     
-    bool        walk(const sf::Vector2i& from,
-                     const sf::Vector2i& to,
-                     bool cornercutting,
-                     bool smoothing);
+    // And for the shortest path tree from the given start.
+    void            buildPathTree(const cNodeID& source, bool corCutAllowed);
+    
+    // And for the connected components.
+    void            buildComponents(bool corCutAllowed);
+
+    // Saves the board, and the tables built so far, for the constructor
+    // above. Throws std::runtime_error if the file can't be written.
+    void            saveSnapshot(const std::string& file) const;
+
+    // Single-threaded convenience version, using the pathfinder's
+    // own workspace. Builds the JPS+ table or hierarchy if needed,
+    // and goes through the path cache if mCachePaths is on.
+    nodevec         findPath(const cNodeID& start,
+                             const cNodeID& end,
+                             bool corCutAllowed = false,
+                             bool smooth = true);
+    
+    // What the last call to the single-threaded findPath() did; all zeros
+    // if it came from the cache. See searchStats.h.
+    const cSearchStats& stats() const { return mWorkspace.stats(); }
+    
+    // And the bound its path was proven to be within (see mSuboptimal).
+    double              bound() const { return mWorkspace.bound(); }
+
+    // Thread safe, given a workspace per thread. The query's statistics
+    // are left in the workspace. Uses the JPS+ table and
+    // the hierarchy only if already built for this corner cutting setting.
+    nodevec         findPath(cWorkspace&,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             bool corCutAllowed = false,
+                             bool smooth = true) const;
+    
+    // The same, into "path" (emptied first). Once the workspace and "path"
+    // have grown to fit the queries at hand, A*, JPS, JPS+ and Theta*, in
+    // either direction, with or without smoothing, don't allocate at all;
+    // HPA* and the shortest path tree still do.
+    void            findPath(cWorkspace&,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             nodevec& path,
+                             bool corCutAllowed = false,
+                             bool smooth = true) const;
+    
+    // The same, but the path goes into "arena", in its compact form (see
+    // pathArena.h); returns its id there, or cPathArena::npos if there's
+    // no path. Nothing is drawn tile by tile: the arena gets the path's
+    // tiles, jump points or waypoints, whichever the search found, and
+    // with smoothing, the waypoints kept.
+    unsigned int    findPath(cWorkspace&,
+                             cPathArena& arena,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             bool corCutAllowed = false,
+                             bool smooth = true) const;
+    
+    // For an agent that keeps its own search state (see replanner.h): the
+    // first query, or one for a new goal, is a full search, and later ones
+    // only redo what board edits and the agent's moves since then have
+    // changed. Paths are shortest ones, as with A*. The query's statistics
+    // are left in the replanner. Thread safe, given a replanner per thread.
+    nodevec         findPath(cReplanner&,
+                             const cNodeID& start,
+                             const cNodeID& goal,
+                             bool corCutAllowed = false,
+                             bool smooth = true) const;
+    
+    // Time-sliced search (see searchHandle.h). beginSearch() sets the
+    // query up in the handle, dropping whatever search it had, but
+    // searches nothing yet. Each step() then runs it on for at most
+    // "expansions" node expansions or "micros" microseconds, whichever
+    // comes first (0 for no limit), though always for at least one
+    // expansion, and returns where it stands. The path, once found, is
+    // left in the handle. Thread safe, given a handle per thread. If a
+    // step throws (see cBoard), the search is cancelled.
+    void            beginSearch(cSearchHandle&,
+                                const cNodeID& start,
+                                const cNodeID& goal,
+                                bool corCutAllowed = false,
+                                bool smooth = true,
+                                bool partial = false) const;
+    cSearchState    step(cSearchHandle&,
+                         unsigned long expansions,
+                         double micros = 0) const;
+
+    // Runs a whole batch of queries on the thread pool and waits for
+    // them; the paths come back in the order of the queries. Given a
+    // vector for them, so do the statistics of each query. If a query
+    // throws (see cBoard), the rest still run, and then the first
+    // exception is thrown on.
+    std::vector<nodevec>    findPaths(const std::vector<cQuery>&,
+                                      bool corCutAllowed = false,
+                                      bool smooth = true,
+                                      std::vector<cSearchStats>* stats = nullptr);
+    
+    // Queues a single query on the thread pool, and returns at once. The
+    // result comes either through the future, or by a call to "done" on
+    // the worker thread that found it. If the search throws, so does the
+    // future's get(); "done" isn't called, and the exception is left for
+    // pool().failure().
+    std::future<nodevec>    findPathAsync(const cNodeID& start,
+                                          const cNodeID& end,
+                                          bool corCutAllowed = false,
+                                          bool smooth = true);
+    void                    findPathAsync(const cNodeID& start,
+                                          const cNodeID& end,
+                                          bool corCutAllowed,
+                                          bool smooth,
+                                          std::function<void(nodevec)> done);
 
 public:
     bool        mJPS { false };
+    cOpenList   mOpenList { cOpenList::binaryHeap };
+    
+    // Search from both ends at once, and join the two halves where they
+    // meet. Fewer expansions on long queries, where a single search would
+    // flood a big disc around the start. Works with A*, and with JPS and
+    // JPS+ if corner cutting is allowed; without it, JPS and JPS+ search
+    // from both ends with A* instead. Paths are still shortest, given a
+    // consistent heuristic (so not with cHeuristic::manhattan). HPA* and
+    // Theta* ignore it.
+    bool        mBidirectional { false };
+    
+    // Bounded suboptimal search (see cSuboptimal): paths of A*, JPS and
+    // JPS+ may cost up to mWeight times the shortest, for far fewer
+    // expansions. Takes precedence over mBidirectional; Theta*, HPA* and
+    // the path tree ignore it. The single-threaded findPath() doesn't use
+    // the path cache with it. The bound each path was proven to be within
+    // is left in the workspace (see cWorkspace::bound()), often much
+    // tighter than mWeight. A weight below 1, or one that could overflow
+    // the 32 bit keys on this board, makes the search throw
+    // std::runtime_error.
+    cSuboptimal mSuboptimal { cSuboptimal::off };
+    double      mWeight { 1.5 };
+
+    // The budget of each cSuboptimal::anytime query: expansions, and wall
+    // clock time from the start of the search; 0 for no limit. When it
+    // runs out, the best path found so far is returned, with its bound
+    // (and if none has been found yet, none).
+    unsigned long   mExpansionBudget { 0 };
+    double          mDeadlineMicros { 0 };
+
+    // How A* and JPS estimate the distance to the goal (see scoring.h).
+    // HPA* always uses octile distance.
+    cHeuristic  mHeuristic { cHeuristic::octile };
+    
+    // JPS+: with mJPS on, jumps are looked up in a precomputed table
+    // instead of being walked. The table is built on the first query
+    // (and rebuilt when the corner cutting setting changes), and kept
+    // up to date incrementally when the board is edited.
+    bool        mJPSPlus { false };
+    
+    // Theta*: A* whose moves may be lines of sight at any angle. Each new
+    // node is linked straight to its parent's parent if it can see it, so
+    // paths come out with few turns, instead of being smoothed after the
+    // fact. Moves cost their straight line length, and mHeuristic picks
+    // the estimate (see cAnyAngleScoring). Unsmoothed, a path is just its
+    // turning points; smoothed, it's the tiles along the lines between
+    // them. Takes precedence over mJPS.
+    bool        mThetaStar { false };
+    
+    // Lazy Theta*: with mThetaStar on, assume the line of sight, and only
+    // check it when the node comes off the open list. Far fewer line
+    // checks, for paths that are nearly as short.
+    bool        mLazyTheta { false };
+    
+    // HPA*: search an abstract graph of cluster entrances, and fill in
+    // the details afterwards (see hierarchy.h). Much faster on long
+    // queries over big boards, but paths may be a little longer than
+    // the shortest. Takes precedence over mJPS; built and kept up to
+    // date the same way as the JPS+ table.
+    bool        mHPA { false };
+    
+    // Answer queries from a shortest path tree grown from the start (see
+    // pathTree.h): one Dijkstra over the whole board, after which every
+    // goal costs only as much as its path is long. Paths are shortest,
+    // as with A*. For agents that always set out from the same place:
+    // the single-threaded findPath() grows a new tree whenever the start
+    // or the corner cutting setting changes, while the other entry points
+    // only use a tree that's already there. Board edits repair the tree
+    // rather than regrow it. Takes precedence over everything else.
+    bool        mPathTree { false };
+    
+    // Turn down queries between tiles that aren't connected at once, by
+    // their component labels (see components.h), instead of searching
+    // everything the start can reach first. Built and kept up to date
+    // the same way as the JPS+ table.
+    bool        mRejectUnreachable { false };
+    
+    // Keep the results of the single-threaded findPath() in a cache,
+    // which board edits invalidate where they touch the cached paths
+    // (see pathCache.h). The other entry points never use it.
+    bool        mCachePaths { false };
+    
+    cPathCache&         pathCache() { return mCache; }
+    const cPathCache&   pathCache() const { return mCache; }
+    
+    const cPathTree&    pathTree() const { return mTree; }
+    const cComponents&  components() const { return mComponents; }
 
 private:
-    void            addToOpenList(const cNodeID& target,
+    // Runs the query, and leaves its path in ws.mPath, as the engine found
+    // it: tiles, jump points, or (for Theta*, if it returns true) any-angle
+    // waypoints, which smoothing leaves as they are.
+    bool            searchFor(cWorkspace& ws,
+                              const cNodeID& start,
+                              const cNodeID& end,
+                              bool corCutAllowed) const;
+    
+    // The part of searchFor() that may throw: hands the query to the
+    // path tree, the hierarchy, or the search for the options set.
+    void            dispatch(cWorkspace& ws,
+                             const cNodeID& start,
+                             const cNodeID& end,
+                             bool corCutAllowed,
+                             bool useJumpTable,
+                             bool tree,
+                             bool hpa) const;
+
+    // The search proper, for the options in K (see searchKernel.h); Q is
+    // the type of the open list, which needs cIndexedHeap's interface.
+    // The searches leave their path in ws.mPath, empty if there's none.
+    template <typename K, typename Q>
+    void            search(cWorkspace& ws,
+                           Q& open,
+                           const cNodeID& start,
+                           const cNodeID& end) const;
+    
+    // Bidirectional version: forward from the start on one open list,
+    // backward from the goal on the other (see mBidirectional).
+    template <typename K, typename Q>
+    void            searchBoth(cWorkspace& ws,
+                               Q& forward,
+                               Q& backward,
+                               const cNodeID& start,
+                               const cNodeID& end) const;
+    
+    // Weighted A* and ARA* (see mSuboptimal); weighted A* is ARA*'s first
+    // round.
+    template <typename K, typename Q>
+    void            searchAnytime(cWorkspace& ws,
+                                  Q& open,
+                                  const cNodeID& start,
+                                  const cNodeID& end) const;
+
+    // Focal search, on ws.mHeap, ws.mFocal and ws.mWaiting.
+    template <typename K>
+    void            searchFocal(cWorkspace& ws,
+                                const cNodeID& start,
+                                const cNodeID& end) const;
+
+    // A step of a time-sliced search, on the handle's own workspace; and
+    // the two that turn its options into template arguments.
+    template <typename K, typename Q>
+    void            searchSlice(cSearchHandle&,
+                                Q& open,
+                                unsigned long expansions,
+                                double micros) const;
+    template <typename S>
+    void            stepWith(cSearchHandle&, unsigned long expansions, double micros) const;
+    template <typename K>
+    void            stepOn(cSearchHandle&, unsigned long expansions, double micros) const;
+
+    // Starts the handle's search over, on the board as it is now.
+    void            restart(cSearchHandle&) const;
+
+    // Theta* and Lazy Theta* (see mThetaStar), for K::anyAngle.
+    template <typename K, typename Q>
+    void            searchAnyAngle(cWorkspace& ws,
+                                   Q& open,
+                                   const cNodeID& start,
+                                   const cNodeID& end) const;
+    
+    // These turn the runtime options into template arguments, one by
+    // one: the engine and corner cutting, the board size, the open list
+    // and the direction.
+    template <typename S>
+    void            searchWith(cWorkspace& ws,
+                               const cNodeID& start,
+                               const cNodeID& end,
+                               bool corCutAllowed,
+                               bool useJumpTable) const;
+    template <typename S, cEngine E, bool CC>
+    void            searchSized(cWorkspace& ws,
+                                const cNodeID& start,
+                                const cNodeID& end) const;
+    template <typename K>
+    void            searchOn(cWorkspace& ws,
+                             const cNodeID& start,
+                             const cNodeID& end) const;
+    
+    template <typename K, typename Q>
+    void            addToOpenList(cWorkspace& ws,
+                                  Q& open,
+                                  const cNodeID& target,
                                   const cNodeID& parent,
-                                  const cNodeID& end);
-    void            addToClosedList(const cNodeID&);
-    unsigned int    calcGscore(const cNodeID&, const cNodeID&) const;
+                                  const cNodeID& end) const;
+    template <typename K>
+    void            addToClosedList(cWorkspace& ws, const cNodeID&) const;
+    template <typename K>
+    unsigned int    calcGscore(const cWorkspace& ws, const cNodeID&, const cNodeID&) const;
+    template <typename K>
     unsigned int    calcHscore(const cNodeID&, const cNodeID&) const;
-    inline bool     onCList(const cNodeID&) const;
-    inline bool     onOList(const cNodeID&) const;
-    nodevec         adjacent(const cNodeID&,
-                                     bool cornerCuttingAllowed = true) const;
-    inline bool     valid(long int x, long int y) const;
-    bool            blocked(long int x, long int y) const;
-
-    void            updateOpenList(const cNodeID& target,
-                                   const cNodeID& new_parent);
-    nodevec         smoothPath(const nodevec&) const;
-    nodevec         walkable(const cNodeID&,
-                             const cNodeID&) const;
-    
-    nodevec         successors(const cNodeID& target,
+    template <typename K>
+    bool            onCList(const cWorkspace& ws, const cNodeID&) const;
+    template <typename K>
+    bool            onOList(const cWorkspace& ws, const cNodeID&) const;
+    template <typename K>
+    void            adjacent(const cNodeID&, cNeighbours&) const;
+
+    template <typename K, typename Q>
+    void            updateOpenList(cWorkspace& ws,
+                                   Q& open,
+                                   const cNodeID& target,
+                                   const cNodeID& new_parent,
+                                   const cNodeID& end) const;
+    // Calls visit(tile) for each tile of the line from a to b, a first
+    // and b last, until it returns false; returns false if it did.
+    template <typename F>
+    bool            traceLine(const cNodeID& a, const cNodeID& b, F visit) const;
+    
+    // Whether the line from a to b could be walked tile by tile: each
+    // tile is free, and (without corner cutting) each diagonal step along
+    // it a legal move. The tiles are those of traceLine(), but checked a
+    // run at a time against the board's bitsets; nothing is allocated.
+    bool            lineOfSight(cSearchStats& stats,
+                                const cNodeID& a,
+                                const cNodeID& b,
+                                bool cornerCutting) const;
+    
+    // The tiles along the lines between consecutive waypoints.
+    void            drawPath(const nodevec& waypoints, nodevec& tiles) const;
+    
+    // The waypoints of "path" smoothed; drawPath() turns them into tiles.
+    void            smoothPath(cSearchStats& stats,
+                               const nodevec& path,
+                               bool cornerCutting,
+                               nodevec& waypoints) const;
+    
+    template <typename K>
+    void            successors(cWorkspace& ws,
+                               const cNodeID& target,
                                const cNodeID& start,
                                const cNodeID& goal,
-                               bool cornerCutting);
+                               cNeighbours&) const;
     
-    nodevec         neighbours(const cNodeID&,
+    template <typename K>
+    void            neighbours(cWorkspace& ws,
                                const cNodeID&,
                                const cNodeID&,
-                               bool cornerCutting,
-                               bool jps);
+                               const cNodeID&,
+                               cNeighbours&) const;
     
-    cNodeID         jump(const cNodeID& current,
+    // False only if the components are in use, up to date, and say there's
+    // no path.
+    bool            reachable(const cNodeID&, const cNodeID&, bool corCutAllowed) const;
+    
+    // Passes an edit of the board on to everything that depends on it.
+    void            edited(const cNodeID&, const cNodeID&);
+    
+    cThreadPool&    pool();
+    cEngine         engine() const;
+    cWorkspace&     workerSpace();
+    
+    template <typename K>
+    cNodeID         jump(cWorkspace& ws,
+                         const cNodeID& current,
                          int dx,
                          int dy,
                          const cNodeID& start,
-                         const cNodeID& goal,
-                         bool corcutallowed) const;
-    
-    bool            has_forced_neighbour(const cNodeID& id,
-                                         int dx,
-                                         int dy) const;
+                         const cNodeID& goal) const;
     
 private:
-    static int                          UID;
-    
-    twoints                             mMatrix[9];
+    // Declared first, so that the mapping outlives everything reading it.
+    std::shared_ptr<const cSnapshot>    mSnapshot;
 
-    std::vector<std::vector<cField>>    mBoard;
-    sf::Vector2u                        mTileSize;
-    sf::Vector2u                        mBoardSize;
-    sf::Vector2u                        mMarkerStart;
-    sf::Vector2u                        mMarkerNow;
-    sf::Vector2f                        mVs;    // view size
-    sf::Vector2f                        mVc;    // view center;
+    cBoard                              mBoard;
+    cJumpTable                          mJumpTable;
+    cHierarchy                          mHierarchy;
+    cPathTree                           mTree;
+    cComponents                         mComponents;
+    
+    cWorkspace                          mWorkspace;     // for the plain findPath()
+    cPathCache                          mCache;         // ditto
+    
+    // The last editLogSize edits of the board, oldest first, for
+    // replanners to catch up on. Every edit bumps the version.
+    struct cEdit {
+        unsigned long   version;
+        cNodeID         a, b;
+    };
+    static const size_t                 editLogSize = 1024;
+    std::deque<cEdit>                   mEdits;
+    unsigned long                       mVersion { 0 };
     
-    cPQ<listElement>                    q;      // priority queue for
-                                                // quick pathfinding.
-    std::vector<sf::Vertex>             mGrid;
+    // One workspace per pool thread, made by the thread itself when it
+    // first needs one. Declared before the pool, so that the pool (and
+    // with it, any search still running) goes away first.
+    std::vector<std::unique_ptr<cWorkspace>>    mWorkerSpaces;
+    std::unique_ptr<cThreadPool>                mPool;
 };
 
 #endif /* defined(__small_astartest__pathfinder__) */
\ No newline at end of file
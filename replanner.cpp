@@ -0,0 +1,230 @@
+#include "replanner.h"
+#include <algorithm>
+#include <cstdlib>
+#include "scoring.h"
+
+const unsigned int cReplanner::npos;
+
+unsigned int cReplanner::cost(const cBoard& b, unsigned int from, unsigned int to) const
+{
+    long fx = from % b.width(), fy = from / b.width();
+    long dx = long(to % b.width()) - fx, dy = long(to / b.width()) - fy;
+
+    if ( b.blocked(fx, fy) || b.blocked(fx + dx, fy + dy) ) return npos;
+    if ( !mCornerCutting && dx != 0 && dy != 0 &&
+         (b.blocked(fx + dx, fy) || b.blocked(fx, fy + dy)) ) return npos;
+    return cOctileScoring::cost(std::abs(dx), std::abs(dy));
+}
+
+unsigned int cReplanner::estimate(const cBoard& b, unsigned int from, unsigned int to) const
+{
+    long dx = long(to % b.width()) - long(from % b.width());
+    long dy = long(to / b.width()) - long(from / b.width());
+    return cOctileScoring::estimate(std::abs(dx), std::abs(dy));
+}
+
+cReplanner::key cReplanner::keyOf(const cBoard& b, unsigned int cell) const
+{
+    auto m = std::min(mG[cell], mRhs[cell]);
+    if ( m == npos ) return ~key(0);
+
+    key k1 = key(m) + estimate(b, b.index(mStart.x, mStart.y), cell) + mKm;
+    return k1 << 32 | m;
+}
+
+unsigned int cReplanner::lookahead(const cBoard& b, unsigned int cell) const
+{
+    long x = cell % b.width(), y = cell / b.width();
+    auto best = npos;
+
+    for ( auto dy = -1; dy < 2; ++dy )
+        for ( auto dx = -1; dx < 2; ++dx )
+        {
+            if ( (dx == 0 && dy == 0) || !b.valid(x + dx, y + dy) ) continue;
+
+            auto n = b.index(x + dx, y + dy);
+            auto c = cost(b, cell, n);
+            if ( c != npos && mG[n] != npos ) best = std::min(best, c + mG[n]);
+        }
+
+    return best;
+}
+
+void cReplanner::requeue(const cBoard& b, unsigned int cell)
+{
+    if ( mG[cell] != mRhs[cell] )
+    {
+        if ( mOpen.contains(cell) )
+        {
+            mOpen.update(cell, keyOf(b, cell));
+            SEARCH_STAT(++mStats.decreases);
+        }
+        else
+        {
+            mOpen.push(cell, keyOf(b, cell));
+            SEARCH_STAT(++mStats.pushes);
+        }
+    }
+    else if ( mOpen.contains(cell) ) mOpen.remove(cell);
+}
+
+void cReplanner::plan(const cBoard& b,
+                      const cNodeID& start,
+                      const cNodeID& goal,
+                      bool cornerCutting,
+                      unsigned long version)
+{
+    mG.assign(b.size(), npos);
+    mRhs.assign(b.size(), npos);
+    mOpen.resize(b.size());
+    mStart = mLast = start;
+    mGoal = goal;
+    mKm = 0;
+    mVersion = version;
+    mCornerCutting = cornerCutting;
+    mPlanned = true;
+
+    auto g = b.index(goal.x, goal.y);
+    mRhs[g] = 0;
+    mOpen.push(g, keyOf(b, g));
+    SEARCH_STAT(++mStats.pushes);
+}
+
+void cReplanner::moveTo(const cNodeID& start)
+{
+    if ( start == mStart ) return;
+
+    mStart = start;
+    mKm += cOctileScoring::estimate(std::abs(mLast.x - start.x), std::abs(mLast.y - start.y));
+    mLast = start;
+}
+
+void cReplanner::edited(const cBoard& b, const cNodeID& a, const cNodeID& c)
+{
+    // Every step whose cost may have changed starts and ends within the
+    // rectangle grown by one tile (a diagonal step may cut a corner in
+    // it); those are the only rhs values that can change.
+    long left = std::max(0, std::min(a.x, c.x) - 1);
+    long top = std::max(0, std::min(a.y, c.y) - 1);
+    long right = std::min<long>(b.width() - 1, std::max(a.x, c.x) + 1);
+    long bottom = std::min<long>(b.height() - 1, std::max(a.y, c.y) + 1);
+
+    auto goal = b.index(mGoal.x, mGoal.y);
+    for ( auto y = top; y <= bottom; ++y )
+        for ( auto x = left; x <= right; ++x )
+        {
+            auto i = b.index(x, y);
+            if ( i == goal ) continue;
+
+            mRhs[i] = lookahead(b, i);
+            requeue(b, i);
+        }
+}
+
+void cReplanner::computeShortestPath(const cBoard& b)
+{
+    auto start = b.index(mStart.x, mStart.y);
+    auto goal = b.index(mGoal.x, mGoal.y);
+
+    while ( !mOpen.empty() && (mOpen.topKey() < keyOf(b, start) || mRhs[start] != mG[start]) )
+    {
+        auto u = mOpen.top();
+        auto oldKey = mOpen.topKey();
+        auto newKey = keyOf(b, u);
+        long ux = u % b.width(), uy = u / b.width();
+
+        if ( oldKey < newKey )
+        {
+            // Queued before the agent last moved.
+            mOpen.update(u, newKey);
+            continue;
+        }
+
+        SEARCH_STAT(++mStats.expanded);
+
+        if ( mG[u] > mRhs[u] )
+        {
+            // Got closer: pass it on to the neighbours.
+            mG[u] = mRhs[u];
+            mOpen.remove(u);
+
+            for ( auto dy = -1; dy < 2; ++dy )
+                for ( auto dx = -1; dx < 2; ++dx )
+                {
+                    if ( (dx == 0 && dy == 0) || !b.valid(ux + dx, uy + dy) ) continue;
+
+                    auto n = b.index(ux + dx, uy + dy);
+                    auto c = cost(b, n, u);
+                    if ( n == goal || c == npos ) continue;
+
+                    if ( mG[u] + c < mRhs[n] )
+                    {
+                        mRhs[n] = mG[u] + c;
+                        requeue(b, n);
+                    }
+                }
+        }
+        else
+        {
+            // Got further: whoever counted on it has to look again.
+            auto old = mG[u];
+            mG[u] = npos;
+            requeue(b, u);
+
+            for ( auto dy = -1; dy < 2; ++dy )
+                for ( auto dx = -1; dx < 2; ++dx )
+                {
+                    if ( (dx == 0 && dy == 0) || !b.valid(ux + dx, uy + dy) ) continue;
+
+                    auto n = b.index(ux + dx, uy + dy);
+                    auto c = cost(b, n, u);
+                    if ( n == goal || c == npos || old == npos || mRhs[n] != old + c ) continue;
+
+                    mRhs[n] = lookahead(b, n);
+                    requeue(b, n);
+                }
+        }
+    }
+}
+
+std::vector<cNodeID> cReplanner::path(const cBoard& b)
+{
+    {
+        cStatTimer searching { mStats.searchMicros };
+        computeShortestPath(b);
+    }
+
+    cStatTimer reconstruction { mStats.reconstructMicros };
+
+    std::vector<cNodeID> path;
+    auto cell = b.index(mStart.x, mStart.y);
+    auto goal = b.index(mGoal.x, mGoal.y);
+    if ( mG[cell] == npos ) return path;
+
+    // Downhill, one step at a time; every step lowers g.
+    path.push_back(mStart);
+    while ( cell != goal )
+    {
+        long x = cell % b.width(), y = cell / b.width();
+        auto best = npos, next = npos;
+
+        for ( auto dy = -1; dy < 2; ++dy )
+            for ( auto dx = -1; dx < 2; ++dx )
+            {
+                if ( (dx == 0 && dy == 0) || !b.valid(x + dx, y + dy) ) continue;
+
+                auto n = b.index(x + dx, y + dy);
+                auto c = cost(b, cell, n);
+                if ( c == npos || mG[n] == npos || c + mG[n] >= best ) continue;
+
+                best = c + mG[n];
+                next = n;
+            }
+
+        if ( next == npos || mG[next] >= mG[cell] ) return std::vector<cNodeID> { };
+        cell = next;
+        path.push_back(b.node(cell));
+    }
+
+    return path;
+}
@@ -0,0 +1,102 @@
+#ifndef __small_astartest__replanner__
+#define __small_astartest__replanner__
+
+#include <vector>
+#include "board.h"
+#include "indexedHeap.h"
+#include "nodeID.h"
+#include "searchStats.h"
+
+// D* Lite: search state that an agent keeps from one query to the next,
+// so that replanning after a board edit only redoes the part of the
+// search the edit actually affects.
+//
+// The search runs backwards, from the goal towards the agent, and keeps
+// two estimates of every tile's distance to the goal: g, what the search
+// settled on, and rhs, what g would be given the neighbours' g values.
+// Tiles where the two differ are "inconsistent", and queued. An edit
+// only recomputes rhs for the tiles around it, so only those become
+// inconsistent. The next query then settles them, and whatever their
+// changes spread to, in order of distance from the agent. It stops as
+// soon as the agent's own tile is settled, as A* would. As the agent
+// moves on, the keys of queued tiles go stale. Rather than requeue them,
+// every key is offset by how far the agent has moved (km), and a stale
+// key is fixed when it comes to the top.
+//
+// Moves cost what they do in A* (see scoring.h), the estimate is octile
+// distance, and paths are shortest ones. They are tile by tile, not
+// smoothed.
+//
+// One cReplanner per agent, used through cPathFinder::findPath(). It
+// starts over when the goal, the corner cutting setting or the board
+// changes size, or when it has missed more edits than the pathfinder
+// remembers. State is kept for every tile of the board: about 20 bytes
+// a tile.
+
+class cReplanner {
+public:
+    cReplanner() { }
+
+    // Forgets the search; the next query starts from scratch.
+    void                reset() { mPlanned = false; }
+
+    bool                planned() const { return mPlanned; }
+    const cNodeID&      goal() const { return mGoal; }
+
+    // What the last query did: tiles taken off the queue (expanded),
+    // queued (pushes), and requeued with a new key (decreases).
+    const cSearchStats& stats() const { return mStats; }
+
+private:
+    friend class cPathFinder;
+
+    typedef unsigned long long  key;    // k1 in the high 32 bits, k2 in the low
+
+    static const unsigned int npos = ~0u;
+
+    // Starts over, for the given query.
+    void            plan(const cBoard&,
+                         const cNodeID& start,
+                         const cNodeID& goal,
+                         bool cornerCutting,
+                         unsigned long version);
+
+    // The agent is now at "start".
+    void            moveTo(const cNodeID& start);
+
+    // The board has changed within the rectangle spanned by the two
+    // corners (inclusive).
+    void            edited(const cBoard&, const cNodeID&, const cNodeID&);
+
+    // Brings the search up to date, and returns the path from the agent
+    // to the goal; empty if there's none.
+    std::vector<cNodeID> path(const cBoard&);
+
+    // What a single step from tile a to the adjacent tile b costs; npos
+    // if it isn't allowed.
+    unsigned int    cost(const cBoard&, unsigned int a, unsigned int b) const;
+    unsigned int    estimate(const cBoard&, unsigned int a, unsigned int b) const;
+    key             keyOf(const cBoard&, unsigned int cell) const;
+
+    // The best distance to the goal through a neighbour: what rhs should be.
+    unsigned int    lookahead(const cBoard&, unsigned int cell) const;
+
+    // Queues the tile if it's inconsistent, and takes it off if it's not.
+    void            requeue(const cBoard&, unsigned int cell);
+    void            computeShortestPath(const cBoard&);
+
+private:
+    std::vector<unsigned int>   mG;     // by cBoard::index
+    std::vector<unsigned int>   mRhs;   // ditto
+    cIndexedHeap<2, key>        mOpen;
+    cNodeID                     mStart;
+    cNodeID                     mLast;  // where the agent was when km was last raised
+    cNodeID                     mGoal;
+    unsigned int                mKm { 0 };
+    unsigned long               mVersion { 0 };     // caught up with the board's edits up to here
+    bool                        mCornerCutting { false };
+    bool                        mPlanned { false };
+    cSearchStats                mStats;
+};
+
+#endif /* defined(__small_astartest__replanner__) */
@@ -0,0 +1,76 @@
+#ifndef __small_astartest__scoring__
+#define __small_astartest__scoring__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Scoring policies for the search: what a move costs, and how far away
+// the goal is estimated to be. Both are integers, in tenths of a tile: a
+// straight step costs 10, a diagonal one 14.
+//
+// A move may span several tiles (JPS jumps do), but always along a
+// straight or diagonal line, so its cost is its octile distance: exact,
+// and with no square roots. The estimates differ in how close they get
+// to that. All three below are consistent, so A* and JPS find shortest
+// paths with any of them; the closer the estimate, the fewer nodes a
+// search expands.
+//
+// Each policy has two static functions of (dx, dy), the absolute
+// differences in coordinates: cost() and estimate(). The search is a
+// template over the policy, picked by cPathFinder::mHeuristic.
+
+// Octile distance: exact on an open board.
+struct cOctileScoring {
+    static unsigned int cost(unsigned int dx, unsigned int dy)
+    {
+        return 10 * std::max(dx, dy) + 4 * std::min(dx, dy);
+    }
+    static unsigned int estimate(unsigned int dx, unsigned int dy) { return cost(dx, dy); }
+};
+
+// Straight line distance. It's scaled so that a diagonal step is 14, as
+// it's charged; that makes it a little lower than octile on straight lines.
+struct cEuclideanScoring {
+    static unsigned int cost(unsigned int dx, unsigned int dy) { return cOctileScoring::cost(dx, dy); }
+    static unsigned int estimate(unsigned int dx, unsigned int dy)
+    {
+        return static_cast<unsigned int>(std::sqrt(double(dx) * dx + double(dy) * dy) * 9.899);
+    }
+};
+
+// Diagonal steps counted as straight ones.
+struct cChebyshevScoring {
+    static unsigned int cost(unsigned int dx, unsigned int dy) { return cOctileScoring::cost(dx, dy); }
+    static unsigned int estimate(unsigned int dx, unsigned int dy) { return 10 * std::max(dx, dy); }
+};
+
+// For Theta*, whose moves are lines of sight at any angle: they cost their
+// straight line length, rounded, so single steps still cost 10 and 14. The
+// estimate is S's. Euclidean stays below the cost; octile may come out a
+// little above it (by 8% at most, on lines far from straight or diagonal),
+// so paths may be that much longer than Theta* could find, but the search
+// is much more focused.
+template <typename S>
+struct cAnyAngleScoring {
+    static unsigned int cost(unsigned int dx, unsigned int dy)
+    {
+        return static_cast<unsigned int>(std::lround(std::sqrt(double(dx) * dx + double(dy) * dy) * 10));
+    }
+    static unsigned int estimate(unsigned int dx, unsigned int dy) { return S::estimate(dx, dy); }
+};
+
+// The original scoring, kept for comparison: Manhattan distance as the
+// estimate, which overestimates diagonal moves (so paths may be longer
+// than the shortest), and rounded down Euclidean length as the cost of a
+// jump.
+struct cManhattanScoring {
+    static unsigned int cost(unsigned int dx, unsigned int dy)
+    {
+        if ( dx + dy > 2 ) return std::sqrt(std::pow(dx, 2) + std::pow(dy, 2)) * 10;
+        return dx != 0 && dy != 0 ? 14 : 10;
+    }
+    static unsigned int estimate(unsigned int dx, unsigned int dy) { return 10 * (dx + dy); }
+};
+
+#endif /* defined(__small_astartest__scoring__) */
@@ -0,0 +1,95 @@
+#ifndef __small_astartest__searchHandle__
+#define __small_astartest__searchHandle__
+
+#include <memory>
+#include <vector>
+#include "enums.h"
+#include "nodeID.h"
+#include "searchStats.h"
+#include "workspace.h"
+
+// A search spread over as many calls as it takes, for a caller that can
+// only spare a little time at once, like a game loop that has a frame to
+// draw. cPathFinder::beginSearch() sets the query up, and each
+// cPathFinder::step() then expands at most so many nodes, or runs for at
+// most so many microseconds, and returns; the next step carries on from
+// there. Nothing is searched in between, so the board may be edited
+// between steps; an edit starts the search over at the next step, whether
+// it had finished or not.
+//
+// The search is A*, JPS or JPS+, as the pathfinder's options were when it
+// began (the JPS+ table only if it was built by then), and paths are the
+// ones findPath() finds. Theta*, HPA*, the path tree, bidirectional and
+// bounded suboptimal search are left out.
+//
+// Given "partial", a step that runs out of budget leaves a path to the
+// expanded tile with the lowest estimate to the goal in path(), for an
+// agent to set off on while the search goes on. It's no part of the path
+// that's found in the end, necessarily.
+//
+// One cSearchHandle per query in flight; it keeps a workspace of its own
+// (see workspace.h), made on first use, and reuses it for the next
+// search. Not thread safe: step it and cancel it from one thread.
+
+class cSearchHandle {
+public:
+    cSearchHandle() { }
+
+    // Drops the search; steps do nothing until the next beginSearch().
+    void                cancel()
+                        {
+                            mState = cSearchState::cancelled;
+                            mPath.clear();
+                        }
+
+    cSearchState        state() const { return mState; }
+    bool                finished() const
+                        {
+                            return mState == cSearchState::found || mState == cSearchState::noPath;
+                        }
+
+    const cNodeID&      start() const { return mStart; }
+    const cNodeID&      goal() const { return mGoal; }
+    bool                cornerCutting() const { return mCornerCutting; }
+    bool                smooth() const { return mSmooth; }
+
+    // The path, once found; until then, the partial path, if asked for,
+    // and empty otherwise.
+    const std::vector<cNodeID>& path() const { return mPath; }
+
+    // What the search has done so far, over all its steps, since
+    // beginSearch(); see searchStats.h.
+    const cSearchStats& stats() const { return mStats; }
+
+    // How many times it has started over since then, after board edits.
+    unsigned long       restarts() const { return mRestarts; }
+
+private:
+    friend class cPathFinder;
+
+    std::unique_ptr<cWorkspace> mWorkspace;
+    std::vector<cNodeID>        mPath;
+    cSearchStats                mStats;
+
+    cNodeID                     mStart;
+    cNodeID                     mGoal;
+    unsigned int                mBest { 0 };    // the expanded tile nearest the goal, by cBoard::index,
+    unsigned int                mBestH { 0 };   // and its estimate
+    unsigned long               mVersion { 0 }; // of the board, when the search began
+    unsigned long               mRestarts { 0 };
+
+    // The pathfinder's options at beginSearch().
+    cHeuristic                  mHeuristic { cHeuristic::octile };
+    cOpenList                   mOpenList { cOpenList::binaryHeap };
+    bool                        mJPS { false };
+    bool                        mJPSPlus { false };
+    bool                        mUseJumpTable { false };
+    bool                        mCornerCutting { false };
+    bool                        mSmooth { false };
+    bool                        mPartial { false };
+
+    bool                        mFresh { true };    // the start isn't on the open list yet
+    cSearchState                mState { cSearchState::idle };
+};
+
+#endif /* defined(__small_astartest__searchHandle__) */
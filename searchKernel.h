@@ -0,0 +1,59 @@
+#ifndef __small_astartest__searchKernel__
+#define __small_astartest__searchKernel__
+
+#include "board.h"
+#include "enums.h"
+
+// The options a search runs with, as template arguments, so that the
+// inner loops don't keep testing them. The search is instantiated for
+// every combination, and cPathFinder::findPath() picks one per query:
+//
+// S: the scoring policy (scoring.h)
+// E: cEngine::aStar, jps, jpsPlus, theta or lazyTheta
+// CC: whether corner cutting is allowed
+// W, H: the board size, if known at compile time; 0 if not.
+//
+// Board sizes are only known if the core is built for one, with
+// -DPATHFINDER_FIXED_WIDTH=... -DPATHFINDER_FIXED_HEIGHT=... (the SFML
+// demo's board is 250 x 250). Boards of that size then get searches with
+// the index arithmetic folded into constants; any other size still works,
+// with a plain search.
+
+#ifndef PATHFINDER_FIXED_WIDTH
+#define PATHFINDER_FIXED_WIDTH 0
+#endif
+
+#ifndef PATHFINDER_FIXED_HEIGHT
+#define PATHFINDER_FIXED_HEIGHT 0
+#endif
+
+template <typename S, cEngine E, bool CC, unsigned int W = 0, unsigned int H = 0>
+struct cKernel {
+    typedef S scoring;
+
+    static const cEngine    engine = E;
+    static const bool       jps = E == cEngine::jps || E == cEngine::jpsPlus;
+    static const bool       anyAngle = E == cEngine::theta || E == cEngine::lazyTheta;
+    static const bool       cornerCutting = CC;
+
+    // The same options, with plain A* as the engine.
+    typedef cKernel<S, cEngine::aStar, CC, W, H> aStar;
+
+    static unsigned int width(const cBoard& b) { return W ? W : b.width(); }
+    static unsigned int height(const cBoard& b) { return H ? H : b.height(); }
+
+    static bool valid(const cBoard& b, long int x, long int y)
+    {
+        return x >= 0 && x < width(b) && y >= 0 && y < height(b);
+    }
+
+    static bool blocked(const cBoard& b, long int x, long int y)
+    {
+        return W && H ? b.blocked<W, H>(x, y) : b.blocked(x, y);
+    }
+
+    static unsigned int index(const cBoard& b, long int x, long int y) { return y * width(b) + x; }
+    static cNodeID node(const cBoard& b, unsigned int i) { return cNodeID(i % width(b), i / width(b)); }
+};
+
+#endif /* defined(__small_astartest__searchKernel__) */
@@ -0,0 +1,72 @@
+#ifndef __small_astartest__searchStats__
+#define __small_astartest__searchStats__
+
+#include <chrono>
+
+// Instrumentation: what a single query did, and where its time went.
+//
+// Every search fills in the cSearchStats of its workspace (see
+// cWorkspace::stats()). Build with -DPATHFINDER_STATS=0 to compile all of
+// it out: the counters aren't touched and the clock isn't read, so the
+// record just stays zero.
+
+#ifndef PATHFINDER_STATS
+#define PATHFINDER_STATS 1
+#endif
+
+struct cSearchStats {
+    unsigned long   expanded { 0 };     // nodes taken off the open list
+    unsigned long   pushes { 0 };       // nodes put on it
+    unsigned long   decreases { 0 };    // ... and given a better score there
+    unsigned long   jumps { 0 };        // JPS jump() calls, recursive ones too, or
+                                        // JPS+ table lookups
+    unsigned long   lineChecks { 0 };   // straight lines tried while smoothing
+
+    // Wall clock time, in microseconds. For HPA*, reconstruction includes
+    // refining the abstract path into tiles.
+    double          searchMicros { 0 };
+    double          reconstructMicros { 0 };
+    double          smoothMicros { 0 };
+};
+
+#if PATHFINDER_STATS
+#define SEARCH_STAT(x) (x)
+#else
+#define SEARCH_STAT(x) ((void)0)
+#endif
+
+// Adds the time from construction to stop() (or destruction, whichever
+// comes first) to a timing field of cSearchStats.
+class cStatTimer {
+public:
+#if PATHFINDER_STATS
+    explicit cStatTimer(double& micros):
+    mMicros(&micros),
+    mStart(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~cStatTimer() { stop(); }
+
+    void    stop()
+            {
+                if ( !mMicros ) return;
+                *mMicros += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                                     mStart).count();
+                mMicros = nullptr;
+            }
+
+private:
+    double*                                 mMicros;
+    std::chrono::steady_clock::time_point   mStart;
+#else
+    explicit cStatTimer(double&) { }
+
+    void    stop() { }
+#endif
+
+    cStatTimer(const cStatTimer&) = delete;
+    cStatTimer& operator=(const cStatTimer&) = delete;
+};
+
+#endif /* defined(__small_astartest__searchStats__) */
@@ -0,0 +1,360 @@
+#include "snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char magic[8] { 'p', 'f', 's', 'n', 'a', 'p', 0, 0 };
+const uint32_t byteOrderMark = 0x01020304;
+const uint32_t otherByteOrder = 0x04030201;
+const size_t alignment = 64;
+
+enum { rowsSection, columnsSection, labelsSection, sizesSection, jumpsSection, hierarchySection,
+       sectionCount };
+
+// The corner cutting setting of each table, in cHeader::flags.
+enum : uint32_t { componentsCorners = 1, jumpsCorners = 2, hierarchyCorners = 4 };
+
+struct cSection {
+    uint64_t    offset;
+    uint64_t    bytes;
+};
+
+struct cHeader {
+    char        magic[8];
+    uint32_t    byteOrder;
+    uint32_t    version;
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    flags;
+    uint32_t    reserved;
+    cSection    sections[sectionCount];
+};
+
+// What sections of a board of w x h tiles must take, if they're there;
+// 0 if any length will do.
+uint64_t expected(int section, uint64_t w, uint64_t h)
+{
+    switch ( section )
+    {
+        case rowsSection:       return (w + 63) / 64 * h * sizeof(uint64_t);
+        case columnsSection:    return (h + 63) / 64 * w * sizeof(uint64_t);
+        case labelsSection:     return w * h * sizeof(unsigned int);
+        case jumpsSection:      return w * h * 8 * sizeof(int16_t);
+        default:                return 0;
+    }
+}
+
+// Appends sections to the file, each on a boundary of its own, and
+// notes where they went in the header.
+class cWriter {
+public:
+    explicit cWriter(const std::string& file):
+    mFile { file },
+    mOut { file, std::ios::binary | std::ios::trunc }
+    {
+        mHeader = cHeader { };
+        std::memcpy(mHeader.magic, magic, sizeof(magic));
+        mHeader.byteOrder = byteOrderMark;
+        mHeader.version = cSnapshot::version;
+        write(&mHeader, sizeof(mHeader));
+    }
+
+    cHeader&    header() { return mHeader; }
+
+    void        begin(int section)
+                {
+                    mSection = -1;
+                    while ( mPosition % alignment != 0 ) write("", 1);
+                    mSection = section;
+                    mHeader.sections[section].offset = mPosition;
+                }
+
+    void        write(const void* data, size_t bytes)
+                {
+                    mOut.write(static_cast<const char*>(data), bytes);
+                    mPosition += bytes;
+                    if ( mSection >= 0 ) mHeader.sections[mSection].bytes += bytes;
+                }
+
+    void        finish()
+                {
+                    mOut.seekp(0);
+                    mOut.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+                    mOut.close();
+                    if ( !mOut ) throw std::runtime_error("Cannot write " + mFile);
+                }
+
+private:
+    std::string     mFile;
+    std::ofstream   mOut;
+    cHeader         mHeader;
+    uint64_t        mPosition { 0 };
+    int             mSection { -1 };
+};
+
+// Reads the words of the HPA* section one by one, and throws if it
+// runs out.
+class cReader {
+public:
+    cReader(const uint32_t* words, size_t count):
+    mNext { words },
+    mEnd { words + count }
+    {
+    }
+
+    uint32_t    next()
+                {
+                    if ( mNext == mEnd ) throw std::runtime_error("Snapshot's hierarchy is cut short.");
+                    return *mNext++;
+                }
+
+    void        take(std::vector<unsigned int>& to, uint64_t count)
+                {
+                    if ( count > static_cast<uint64_t>(mEnd - mNext) )
+                        throw std::runtime_error("Snapshot's hierarchy is cut short.");
+                    to.assign(mNext, mNext + count);
+                    mNext += count;
+                }
+
+    template <typename L>
+    void        take(L& links)
+                {
+                    links.resize(next());
+                    for ( auto& l : links )
+                    {
+                        l.first = next();
+                        l.second = next();
+                    }
+                }
+
+private:
+    const uint32_t*     mNext;
+    const uint32_t*     mEnd;
+};
+
+template <typename L>
+void put(std::vector<uint32_t>& words, const L& links)
+{
+    words.push_back(static_cast<uint32_t>(links.size()));
+    for ( auto& l : links )
+    {
+        words.push_back(l.first);
+        words.push_back(l.second);
+    }
+}
+
+}
+
+const uint32_t cSnapshot::version;
+
+cSnapshot::cSnapshot(const std::string& file)
+{
+    auto fd = ::open(file.c_str(), O_RDONLY);
+    if ( fd < 0 ) throw std::runtime_error("Cannot open " + file);
+
+    struct stat info;
+    if ( ::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(cHeader) )
+    {
+        ::close(fd);
+        throw std::runtime_error("Not a snapshot: " + file);
+    }
+
+    auto data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if ( data == MAP_FAILED ) throw std::runtime_error("Cannot map " + file);
+    mData = static_cast<const unsigned char*>(data);
+    mBytes = info.st_size;
+
+    auto fail = [&](const std::string& why)
+    {
+        ::munmap(const_cast<unsigned char*>(mData), mBytes);
+        throw std::runtime_error(why);
+    };
+
+    auto& h = *reinterpret_cast<const cHeader*>(mData);
+    if ( std::memcmp(h.magic, magic, sizeof(magic)) != 0 ) fail("Not a snapshot: " + file);
+    if ( h.byteOrder == otherByteOrder ) fail(file + " was saved on a machine of the other byte order.");
+    if ( h.byteOrder != byteOrderMark ) fail("Not a snapshot: " + file);
+    if ( h.version != version )
+        fail(file + " is a version " + std::to_string(h.version) + " snapshot; this reads version " +
+             std::to_string(version) + ".");
+
+    for ( auto i = 0; i < sectionCount; ++i )
+    {
+        auto& s = h.sections[i];
+        if ( s.bytes == 0 ) continue;
+        if ( s.offset % alignment != 0 || s.offset > mBytes || s.bytes > mBytes - s.offset )
+            fail("Snapshot " + file + " is cut short, or damaged.");
+        auto e = expected(i, h.width, h.height);
+        if ( (e != 0 && s.bytes != e) || s.bytes % sizeof(uint32_t) != 0 )
+            fail("Snapshot " + file + " doesn't fit its board.");
+    }
+    if ( h.sections[rowsSection].bytes == 0 || h.sections[columnsSection].bytes == 0 ||
+         (h.sections[labelsSection].bytes == 0) != (h.sections[sizesSection].bytes == 0) )
+        fail("Snapshot " + file + " is missing sections.");
+}
+
+cSnapshot::~cSnapshot()
+{
+    ::munmap(const_cast<unsigned char*>(mData), mBytes);
+}
+
+unsigned int cSnapshot::width() const
+{
+    return reinterpret_cast<const cHeader*>(mData)->width;
+}
+
+unsigned int cSnapshot::height() const
+{
+    return reinterpret_cast<const cHeader*>(mData)->height;
+}
+
+const void* cSnapshot::section(int i, size_t& bytes) const
+{
+    auto& s = reinterpret_cast<const cHeader*>(mData)->sections[i];
+    bytes = s.bytes;
+    return s.bytes > 0 ? mData + s.offset : nullptr;
+}
+
+const uint64_t* cSnapshot::rows() const
+{
+    size_t bytes;
+    return static_cast<const uint64_t*>(section(rowsSection, bytes));
+}
+
+const uint64_t* cSnapshot::columns() const
+{
+    size_t bytes;
+    return static_cast<const uint64_t*>(section(columnsSection, bytes));
+}
+
+void cSnapshot::restore(const cBoard& b, cComponents& c, cJumpTable& j, cHierarchy& h) const
+{
+    auto flags = reinterpret_cast<const cHeader*>(mData)->flags;
+    size_t bytes;
+
+    if ( auto labels = section(labelsSection, bytes) )
+    {
+        auto sizes = static_cast<const unsigned int*>(section(sizesSection, bytes));
+        c.clear();
+        c.mLabels = static_cast<const unsigned int*>(labels);
+        c.mSize.assign(sizes, sizes + bytes / sizeof(unsigned int));
+        for ( unsigned int l = 0; l < c.mSize.size(); ++l )
+            if ( c.mSize[l] == 0 ) c.mFree.push_back(l);
+        c.mCount = c.mSize.size() - c.mFree.size();
+        c.mCornerCutting = flags & componentsCorners;
+        c.mBuilt = true;
+    }
+
+    if ( auto jumps = section(jumpsSection, bytes) )
+    {
+        j.clear();
+        j.mTable = static_cast<const int16_t*>(jumps);
+        j.mCornerCutting = flags & jumpsCorners;
+        j.mBuilt = true;
+    }
+
+    if ( auto words = section(hierarchySection, bytes) )
+    {
+        cReader in { static_cast<const uint32_t*>(words), bytes / sizeof(uint32_t) };
+        h.clear();
+        h.mSize = in.next();
+        h.mClustersX = in.next();
+        h.mClustersY = in.next();
+        if ( h.mSize == 0 ||
+             h.mClustersX != (b.width() + h.mSize - 1) / h.mSize ||
+             h.mClustersY != (b.height() + h.mSize - 1) / h.mSize )
+        {
+            h.clear();
+            throw std::runtime_error("Snapshot's hierarchy doesn't fit its board.");
+        }
+
+        auto count = h.mClustersX * h.mClustersY;
+        h.mClusters.resize(count);
+        for ( auto& cluster : h.mClusters )
+        {
+            uint64_t n = in.next();
+            in.take(cluster.nodes, n);
+            in.take(cluster.dist, n * n);
+            in.take(cluster.across);
+        }
+        for ( auto side : { &h.mEast, &h.mSouth, &h.mSouthEast, &h.mSouthWest } )
+        {
+            side->resize(count);
+            for ( auto& links : *side ) in.take(links);
+        }
+        h.mCornerCutting = flags & hierarchyCorners;
+        h.mBuilt = true;
+    }
+}
+
+void cSnapshot::save(const std::string& file,
+                     const cBoard& b,
+                     const cComponents& c,
+                     const cJumpTable& j,
+                     const cHierarchy& h)
+{
+    cWriter out { file };
+    auto& header = out.header();
+    header.width = b.width();
+    header.height = b.height();
+
+    std::vector<uint64_t> words;
+    out.begin(rowsSection);
+    for ( long int y = 0; y < b.height(); ++y )
+    {
+        words.clear();
+        for ( long int k = 0; k < (b.width() + 63) / 64; ++k ) words.push_back(b.rowWord(y, k));
+        out.write(words.data(), words.size() * sizeof(uint64_t));
+    }
+    out.begin(columnsSection);
+    for ( long int x = 0; x < b.width(); ++x )
+    {
+        words.clear();
+        for ( long int k = 0; k < (b.height() + 63) / 64; ++k ) words.push_back(b.columnWord(x, k));
+        out.write(words.data(), words.size() * sizeof(uint64_t));
+    }
+
+    if ( c.built() )
+    {
+        out.begin(labelsSection);
+        out.write(c.mLabels, b.size() * sizeof(unsigned int));
+        out.begin(sizesSection);
+        out.write(c.mSize.data(), c.mSize.size() * sizeof(unsigned int));
+        if ( c.cornerCutting() ) header.flags |= componentsCorners;
+    }
+
+    if ( j.built() )
+    {
+        out.begin(jumpsSection);
+        out.write(j.mTable, b.size() * 8 * sizeof(int16_t));
+        if ( j.cornerCutting() ) header.flags |= jumpsCorners;
+    }
+
+    if ( h.built() )
+    {
+        std::vector<uint32_t> graph { h.mSize, h.mClustersX, h.mClustersY };
+        for ( auto& cluster : h.mClusters )
+        {
+            graph.push_back(static_cast<uint32_t>(cluster.nodes.size()));
+            graph.insert(graph.end(), cluster.nodes.begin(), cluster.nodes.end());
+            graph.insert(graph.end(), cluster.dist.begin(), cluster.dist.end());
+            put(graph, cluster.across);
+        }
+        for ( auto side : { &h.mEast, &h.mSouth, &h.mSouthEast, &h.mSouthWest } )
+            for ( auto& links : *side ) put(graph, links);
+
+        out.begin(hierarchySection);
+        out.write(graph.data(), graph.size() * sizeof(uint32_t));
+        if ( h.cornerCutting() ) header.flags |= hierarchyCorners;
+    }
+
+    out.finish();
+}
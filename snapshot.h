@@ -0,0 +1,85 @@
+#ifndef __small_astartest__snapshot__
+#define __small_astartest__snapshot__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "board.h"
+#include "components.h"
+#include "hierarchy.h"
+#include "jumpTable.h"
+
+// A pathfinder's board, and whichever tables were built over it, saved in
+// one binary file that's mapped into memory to be read back.
+//
+// The file starts with a header: the magic "pfsnap\0\0", a byte order
+// mark, the format version, the board's size, flags (the corner cutting
+// setting of each table), and the offset and length of every section;
+// a section that's left out has length 0. The sections are:
+//
+//  - the board's bits, row by row and column by column, exactly as a
+//    flat cBoard keeps them;
+//  - the component labels, by cBoard::index, and the tile count of each
+//    label (see components.h);
+//  - the JPS+ jump distances, 8 per tile (see jumpTable.h);
+//  - the HPA* graph (see hierarchy.h), as a run of 32 bit words: the
+//    cluster size and count, then each cluster's nodes, distance matrix
+//    and links across its border, then the four lists of entrances
+//    between neighbouring clusters.
+//
+// Every section starts on a 64 byte boundary, and everything is stored
+// in the byte order of the machine that saved it. Opening a snapshot
+// doesn't parse it: the header is checked, and the board, the labels and
+// the jump distances are then read right where they are in the mapping,
+// so that the operating system only brings in the pages that searches
+// touch. Only the HPA* graph, which is made of a small vector per
+// cluster, is copied out. An edit copies what it changes first; the file
+// is never written to. The path tree isn't saved, since it belongs to
+// one start.
+//
+// A snapshot of another version, or from a machine of the other byte
+// order, is turned down; so is one whose sections don't fit the board
+// or the file. Nothing past that is checked.
+
+class cSnapshot {
+public:
+    static const uint32_t version = 1;
+
+    // Maps the file. Throws std::runtime_error if it can't, or if it isn't
+    // a snapshot this version can read.
+    explicit cSnapshot(const std::string& file);
+    ~cSnapshot();
+
+    cSnapshot(const cSnapshot&) = delete;
+    cSnapshot& operator=(const cSnapshot&) = delete;
+
+    unsigned int    width() const;
+    unsigned int    height() const;
+
+    // The board's bits, to be borrowed by a cBoard (see board.h).
+    const uint64_t* rows() const;
+    const uint64_t* columns() const;
+
+    // Sets up the tables the snapshot has; the others are left alone.
+    // The board must be the snapshot's, and the snapshot must outlive
+    // the tables, or at least their first edit.
+    void            restore(const cBoard&, cComponents&, cJumpTable&, cHierarchy&) const;
+
+    // Writes the board, and the tables that are built, to the file.
+    // A paged board is loaded chunk by chunk to do so. Throws
+    // std::runtime_error if the file can't be written.
+    static void     save(const std::string& file,
+                         const cBoard&,
+                         const cComponents&,
+                         const cJumpTable&,
+                         const cHierarchy&);
+
+private:
+    const void*     section(int, size_t& bytes) const;
+
+private:
+    const unsigned char*    mData { nullptr };
+    size_t                  mBytes { 0 };
+};
+
+#endif /* defined(__small_astartest__snapshot__) */
@@ -0,0 +1,123 @@
+#include "threadPool.h"
+#include <algorithm>
+
+namespace {
+
+// Which pool (if any) the current thread works for, and as which worker.
+thread_local const cThreadPool*     tPool { nullptr };
+thread_local int                    tIndex { -1 };
+
+}
+
+cThreadPool::cThreadPool(unsigned int threads)
+{
+    if ( threads == 0 ) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for ( auto i = 0u; i < threads; ++i )
+        mQueues.emplace_back(new cQueue);
+
+    for ( auto i = 0u; i < threads; ++i )
+        mThreads.emplace_back(&cThreadPool::work, this, i);
+}
+
+cThreadPool::~cThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock { mSleep };
+        mStop = true;
+    }
+    mWake.notify_all();
+
+    for ( auto& t : mThreads )
+        t.join();
+}
+
+int cThreadPool::workerIndex() const
+{
+    return tPool == this ? tIndex : -1;
+}
+
+void cThreadPool::submit(std::function<void()> task)
+{
+    auto self = workerIndex();
+    auto target = self >= 0 ? self : mNext++ % size();
+
+    {
+        // Counted under the sleep mutex, so a worker about to go to
+        // sleep can't miss it; and counted before it's queued, so the
+        // count never drops below the number of tasks in the queues.
+        std::lock_guard<std::mutex> lock { mSleep };
+        ++mPending;
+    }
+    {
+        std::lock_guard<std::mutex> lock { mQueues[target]->m };
+        mQueues[target]->tasks.push_back(std::move(task));
+    }
+    mWake.notify_one();
+}
+
+bool cThreadPool::runOne(unsigned int self)
+{
+    std::function<void()>   task;
+    auto                    n = size();
+
+    // Own queue first, newest task first...
+    {
+        std::lock_guard<std::mutex> lock { mQueues[self]->m };
+        auto& q = mQueues[self]->tasks;
+        if ( !q.empty() )
+        {
+            task = std::move(q.back());
+            q.pop_back();
+        }
+    }
+
+    // ... then steal the oldest task of somebody else.
+    for ( auto i = 1u; !task && i < n; ++i )
+    {
+        auto& victim = *mQueues[(self + i) % n];
+        std::lock_guard<std::mutex> lock { victim.m };
+        if ( !victim.tasks.empty() )
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if ( !task ) return false;
+
+    --mPending;
+    try
+    {
+        task();
+    }
+    catch ( ... )
+    {
+        std::lock_guard<std::mutex> lock { mFailureLock };
+        if ( !mFailure ) mFailure = std::current_exception();
+    }
+    return true;
+}
+
+std::exception_ptr cThreadPool::failure()
+{
+    std::lock_guard<std::mutex> lock { mFailureLock };
+    auto f = mFailure;
+    mFailure = nullptr;
+    return f;
+}
+
+void cThreadPool::work(unsigned int self)
+{
+    tPool = this;
+    tIndex = self;
+
+    while ( true )
+    {
+        if ( runOne(self) ) continue;
+
+        std::unique_lock<std::mutex> lock { mSleep };
+        mWake.wait(lock, [this] { return mStop || mPending > 0; });
+        if ( mStop && mPending == 0 ) return;
+    }
+}
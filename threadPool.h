@@ -0,0 +1,100 @@
+#ifndef __small_astartest__threadPool__
+#define __small_astartest__threadPool__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing thread pool.
+//
+// Every worker has a queue of its own. Tasks submitted from a worker go to
+// the back of that worker's queue, and a worker takes its own work from the
+// back too (the most recent task, whose data is likely still in its cache).
+// A worker whose queue has run dry steals from the front of the others',
+// so a batch of uneven tasks still keeps every core busy.
+//
+// The destructor runs every task still queued, then joins the workers.
+//
+// A task that throws doesn't take its worker (and with it the program)
+// down: the worker keeps the exception for failure(), and goes on. Tasks
+// that have someone waiting on them should catch and pass on their own.
+
+class cThreadPool {
+public:
+    // 0 threads: as many as there are cores.
+    explicit cThreadPool(unsigned int threads = 0);
+    ~cThreadPool();
+
+    cThreadPool(const cThreadPool&) = delete;
+    cThreadPool& operator=(const cThreadPool&) = delete;
+
+    unsigned int    size() const { return static_cast<unsigned int>(mThreads.size()); }
+
+    void            submit(std::function<void()>);
+
+    // The index (0 .. size()-1) of the calling thread, if it's one of
+    // this pool's workers; -1 otherwise.
+    int             workerIndex() const;
+
+    // The first exception a task let through since the last call, or
+    // nullptr; taken, so the next call won't see it again.
+    std::exception_ptr failure();
+
+private:
+    struct cQueue {
+        std::mutex                          m;
+        std::deque<std::function<void()>>   tasks;
+    };
+
+    void            work(unsigned int self);
+    bool            runOne(unsigned int self);
+
+private:
+    std::vector<std::unique_ptr<cQueue>>    mQueues;
+    std::vector<std::thread>                mThreads;
+
+    std::mutex                              mSleep;
+    std::condition_variable                 mWake;
+    std::atomic<size_t>                     mPending { 0 };
+    std::atomic<unsigned int>               mNext { 0 };    // round robin for outsiders
+    bool                                    mStop { false };
+
+    std::mutex                              mFailureLock;
+    std::exception_ptr                      mFailure;
+};
+
+// Runs f(0) .. f(n-1) on all cores, and returns when they're all done.
+// For one-off bulk jobs (building tables) that don't need a pool of their
+// own. Indices are handed out in small batches, so uneven work (diagonals
+// of very different lengths) still gets spread evenly; a batch of 1 suits
+// few, but heavy items.
+template <typename F>
+void parallelFor(size_t n, F f, size_t batch = 64)
+{
+    std::atomic<size_t>     next { 0 };
+
+    auto work = [&]()
+    {
+        size_t i;
+        while ( (i = next.fetch_add(batch)) < n )
+            for ( auto j = i; j < std::min(n, i + batch); ++j )
+                f(j);
+    };
+
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for ( auto t = 1u; t < threads; ++t )
+        pool.emplace_back(work);
+    work();
+    for ( auto& t : pool )
+        t.join();
+}
+
+#endif /* defined(__small_astartest__threadPool__) */
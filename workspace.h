@@ -0,0 +1,114 @@
+#ifndef __small_astartest__workspace__
+#define __small_astartest__workspace__
+
+#include <vector>
+#include <cstddef>
+#include "indexedHeap.h"
+#include "bucketQueue.h"
+#include "nodeID.h"
+#include "searchStats.h"
+
+struct twoints {
+    int x, y;
+    bool ok;
+};
+
+// The neighbours of a tile, or the successors of a jump point: never more
+// than eight, so they're kept in place rather than on the heap.
+class cNeighbours {
+public:
+    void            clear() { mCount = 0; }
+    void            push_back(const cNodeID& id) { mNodes[mCount++] = id; }
+    bool            empty() const { return mCount == 0; }
+    size_t          size() const { return mCount; }
+    const cNodeID*  begin() const { return mNodes; }
+    const cNodeID*  end() const { return mNodes + mCount; }
+
+private:
+    cNodeID         mNodes[8];
+    unsigned int    mCount { 0 };
+};
+
+// Everything a single search writes to: scores, parents, the open list and
+// so on. It's kept apart from the board (which searches only read), so any
+// number of searches can run on the same cPathFinder at the same time, as
+// long as each has a workspace of its own.
+//
+// A workspace is made for a board of a given number of cells, and can be
+// reused for any number of queries on it; nothing needs clearing between
+// them, thanks to the UID stamps. Nothing in it shrinks, either, so once
+// it has grown to fit the queries at hand, a search allocates nothing.
+
+class cWorkspace {
+public:
+    explicit cWorkspace(size_t cells):
+    mGscore(cells),
+    mParent(cells),
+    mWhichList(cells, 0),
+    mHeap { cells },
+    mBuckets { cells }
+    {
+    }
+
+    size_t      size() const { return mGscore.size(); }
+    
+    // What the last query run in this workspace did. For HPA*, that
+    // includes the searches within clusters.
+    const cSearchStats& stats() const { return mStats; }
+
+    // After a query with cPathFinder::mSuboptimal set, how far its path
+    // was proven to be from the shortest: it costs at most bound() times
+    // as much (so 1 is a shortest path). 0 if there was no path, or the
+    // query didn't go through one of those searches.
+    double      bound() const { return mBound; }
+
+private:
+    friend class cPathFinder;
+    friend class cHierarchy;
+
+    int                                 UID { 1 };  // unique ID of the current search
+    cSearchStats                        mStats;
+    double                              mBound { 0 };
+
+    twoints                             mMatrix[9];
+    cNeighbours                         mNeighbours;    // of the node being expanded
+
+    // The path as found, and the waypoints kept by smoothing it.
+    std::vector<cNodeID>                mPath;
+    std::vector<cNodeID>                mWaypoints;
+
+    // Per-search data, indexed by cBoard::index(x, y).
+    std::vector<unsigned int>           mGscore;
+    std::vector<unsigned int>           mParent;    // index of the parent
+    std::vector<int>                    mWhichList; // UID: open, -UID: closed
+
+    cIndexedHeap<>                      mHeap;      // the open list, keyed by
+    cBucketQueue                        mBuckets;   // f score; see mOpenList.
+    
+    // The other half of a bidirectional search; sized on first use. The
+    // side that's expanding swaps its arrays in above.
+    std::vector<unsigned int>           mGscoreB;
+    std::vector<unsigned int>           mParentB;
+    std::vector<int>                    mWhichListB;
+    cIndexedHeap<>                      mHeapB;
+    cBucketQueue                        mBucketsB;
+    
+    // Focal search keeps the open nodes within its bound on mFocal, keyed
+    // by h, and the others on mWaiting, by g + h; all of them are on mHeap
+    // too. Sized on first use. ARA* keeps the nodes it has to look at
+    // again in the next round in mInconsistent.
+    cIndexedHeap<>                      mFocal;
+    cIndexedHeap<>                      mWaiting;
+    std::vector<unsigned int>           mInconsistent;
+
+    // HPA* searches inside a single cluster, indexed by tile within it;
+    // sized by cHierarchy on first use.
+    std::vector<char>                   mLocalWalkable;
+    std::vector<char>                   mLocalTarget;
+    std::vector<unsigned int>           mLocalDist;
+    std::vector<unsigned int>           mLocalParent;
+    cBucketQueue                        mLocalOpen;
+    std::vector<unsigned int>           mGoalDist;  // goal's cluster's entrances -> goal
+};
+
+#endif /* defined(__small_astartest__workspace__) */